@@ -65,22 +65,36 @@ void vClearTickInterrupt(void);
 #define configIDLE_SHOULD_YIELD                 1
 #define configUSE_TASK_NOTIFICATIONS            1
 #define configTASK_NOTIFICATION_ARRAY_ENTRIES   3
+#define configDRIVER_NOTIFY_INDEX               1   /* Slot used by blocking driver calls (SPI, I2C) */
+#define configCONSOLE_NOTIFY_INDEX              2   /* Slot used by the console receive interrupt (console.h) */
 
 /* Memory allocation configuration */
 #define configSUPPORT_DYNAMIC_ALLOCATION        1
-#define configSUPPORT_STATIC_ALLOCATION         0
+#define configSUPPORT_STATIC_ALLOCATION         1   /* Boot tasks, idle and timer task - see app_tasks.h */
+#ifdef MEMSTAT_HEAP_SIZE
+#define configTOTAL_HEAP_SIZE                   ( ( size_t ) MEMSTAT_HEAP_SIZE )    /* From a memstat report */
+#else
 #define configTOTAL_HEAP_SIZE                   ( ( size_t ) ( 32 * 1024 * 1024 ) ) /* 32MB */
-#define configAPPLICATION_ALLOCATED_HEAP        0
+#endif
+#define configAPPLICATION_ALLOCATED_HEAP        1   /* ucHeap in .heap (not cleared at boot) */
 
 /* Hook function configuration */
-#define configUSE_IDLE_HOOK                     0
+#define configUSE_IDLE_HOOK                     1   /* WFI, load accounting, background jobs - see idle.h */
 #define configUSE_TICK_HOOK                     0
 #define configUSE_MALLOC_FAILED_HOOK            1
-#define configUSE_DAEMON_TASK_STARTUP_HOOK      0
+#define configUSE_DAEMON_TASK_STARTUP_HOOK      1   /* Boot timeline report */
+#ifdef PRODUCTION_BUILD
+#define configCHECK_FOR_STACK_OVERFLOW          0   /* Static stacks have MMU guard pages - see mmu.h */
+#else
 #define configCHECK_FOR_STACK_OVERFLOW          2
-
-/* Run time and task stats gathering */
-#define configGENERATE_RUN_TIME_STATS           0
+#endif
+#define configUSE_STACK_GUARD                   1   /* Unmapped page below every APP_TASK_STACK() */
+
+/* Run time and task stats gathering - the counter is CNTPCT / 256
+ * (75 kHz, 32 bits wrap after 15.9 hours); the shell's ps takes deltas */
+#define configGENERATE_RUN_TIME_STATS           1
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()    /* CNTPCT always runs */
+#define portGET_RUN_TIME_COUNTER_VALUE()        ( ( uint32_t ) ( cpu_cntpct() >> 8 ) )
 #define configUSE_TRACE_FACILITY                1
 #define configUSE_STATS_FORMATTING_FUNCTIONS    1
 
@@ -92,7 +106,11 @@ void vClearTickInterrupt(void);
 #define configUSE_TIMERS                        1
 #define configTIMER_TASK_PRIORITY               ( configMAX_PRIORITIES - 1 )
 #define configTIMER_QUEUE_LENGTH                10
+#ifdef MEMSTAT_STACK_TIMER
+#define configTIMER_TASK_STACK_DEPTH            MEMSTAT_STACK_TIMER                 /* From a memstat report */
+#else
 #define configTIMER_TASK_STACK_DEPTH            ( configMINIMAL_STACK_SIZE * 2 )
+#endif
 
 /* Queue and semaphore configuration */
 #define configQUEUE_REGISTRY_SIZE               8
@@ -123,8 +141,28 @@ void vClearTickInterrupt(void);
 #define configUNIQUE_INTERRUPT_PRIORITIES       32
 #define configMAX_API_CALL_INTERRUPT_PRIORITY   18  /* Higher priority number = lower priority */
 
+/* FPU context: only tasks flagged as FPU users save D0-D31/FPSCR.
+ * Flags are set on first use by the lazy FPU trap (see fpu.h) */
+#define configUSE_TASK_FPU_SUPPORT              1
+
+/* Flight recorder: scheduler, queue and ISR events in a ring that survives reset (see trace.h) */
+#define configUSE_FLIGHT_RECORDER               1
+
+/* Per-source IRQ counts, latency and handler time for the shell's irq command (bcm2837_irq.h) */
+#define configUSE_IRQ_STATS                     1
+
+/* Allocation histogram and stack high-water sampling for right-sizing (see memstat.h) */
+#define configUSE_MEMSTAT                       1
+
+/* Trace hooks - expanded inside tasks.c, queue.c and heap_4.c */
+#include "fpu.h"
+#include "trace.h"
+#include "memstat.h"
+#define traceTASK_SWITCHED_IN()                 do { fpu_lazy_switch_in( ( uint32_t ) pxCurrentTCB->pxTopOfStack[ 0 ] ); TRACE_TASK_SWITCHED_IN(); } while( 0 )
+
 /* Assertion configuration */
-extern void vAssertCalled( unsigned long ulLine, const char * const pcFileName );
+/* cold: every configASSERT() failure branch is laid out as unlikely, out of line */
+extern void vAssertCalled( unsigned long ulLine, const char * const pcFileName ) __attribute__( ( cold ) );
 /* BCM2837-specific: Assertions enabled with GIC stub support */
 #define configASSERT( x ) if( ( x ) == 0 ) vAssertCalled( __LINE__, __FILE__ )
 
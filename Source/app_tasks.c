@@ -0,0 +1,86 @@
+/*
+ * Declarative boot-time task table for RPi2 BCM2837
+ * Processes the app_tasks linker section built by APP_TASK()
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "app_tasks.h"
+#include "uart.h"
+#include "placement.h"
+
+/* Table bounds - provided by link_rpi2.ld */
+extern const app_task_t __start_app_tasks[];
+extern const app_task_t __stop_app_tasks[];
+#ifndef HOST_SIM
+extern uint8_t __task_stacks_start__[];
+extern uint8_t __task_stacks_end__[];
+extern uint8_t __task_tcbs_start__[];
+extern uint8_t __task_tcbs_end__[];
+#else
+extern uint8_t __start_task_stacks[];
+extern uint8_t __stop_task_stacks[];
+extern uint8_t __start_task_tcbs[];
+extern uint8_t __stop_task_tcbs[];
+#define __task_stacks_start__   __start_task_stacks
+#define __task_stacks_end__     __stop_task_stacks
+#define __task_tcbs_start__     __start_task_tcbs
+#define __task_tcbs_end__       __stop_task_tcbs
+#endif
+
+/* Entry for APP_TASK_FPU tasks: claim an FPU context, then run the task */
+static void app_task_fpu_entry(void *pvParameters) {
+    const app_task_t *t = (const app_task_t *)pvParameters;
+
+    portTASK_USES_FLOATING_POINT();
+    t->function(NULL);
+}
+
+COLD_FUNC unsigned int app_tasks_create_all(void) {
+    unsigned int created = 0;
+
+    for (const app_task_t *t = __start_app_tasks; t < __stop_app_tasks; t++) {
+        int guarded = APP_TASK_GUARD(t->stack, t->name);
+
+        if (t->flags & APP_TASK_FPU) {
+            *t->handle = xTaskCreateStatic(app_task_fpu_entry, t->name, t->stack_depth,
+                                           (void *)t, t->priority, t->stack, t->tcb);
+        } else {
+            *t->handle = xTaskCreateStatic(t->function, t->name, t->stack_depth, NULL,
+                                           t->priority, t->stack, t->tcb);
+        }
+        configASSERT(*t->handle != NULL);
+
+        uart_printf("  %s: prio %u, stack %u bytes%s%s\n", t->name, (uint32_t)t->priority,
+                    t->stack_depth * (uint32_t)sizeof(StackType_t),
+                    (t->flags & APP_TASK_FPU) ? ", FPU" : "", guarded ? ", guard page" : "");
+        created++;
+    }
+
+    return created;
+}
+
+COLD_FUNC void app_tasks_print_map(void) {
+    uart_puts("=== STATIC TASK MEMORY MAP ===\r\n");
+    uart_printf("Task stacks: %x - %x (%u bytes)\n",
+                (uint32_t)(uintptr_t)__task_stacks_start__, (uint32_t)(uintptr_t)__task_stacks_end__,
+                (uint32_t)(__task_stacks_end__ - __task_stacks_start__));
+    uart_printf("Task TCBs:   %x - %x (%u bytes)\n",
+                (uint32_t)(uintptr_t)__task_tcbs_start__, (uint32_t)(uintptr_t)__task_tcbs_end__,
+                (uint32_t)(__task_tcbs_end__ - __task_tcbs_start__));
+
+    for (const app_task_t *t = __start_app_tasks; t < __stop_app_tasks; t++) {
+        uart_printf("  %s: stack %x +%u, TCB %x +%u\n", t->name,
+                    (uint32_t)(uintptr_t)t->stack, t->stack_depth * (uint32_t)sizeof(StackType_t),
+                    (uint32_t)(uintptr_t)t->tcb, (uint32_t)sizeof(StaticTask_t));
+    }
+}
+
+const app_task_t *app_tasks_find(TaskHandle_t handle) {
+    for (const app_task_t *t = __start_app_tasks; t < __stop_app_tasks; t++) {
+        if (*t->handle == handle) {
+            return t;
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,124 @@
+/*
+ * Declarative boot-time task table for RPi2 BCM2837
+ *
+ * APP_TASK() statically allocates a task's TCB and stack and adds a
+ * descriptor to the app_tasks linker section. app_tasks_create_all()
+ * walks that table at boot with xTaskCreateStatic(), so boot tasks never
+ * touch the FreeRTOS heap and cannot fail to allocate at runtime.
+ *
+ * Stacks live in the .task_stacks section (not cleared at boot - FreeRTOS
+ * fills them itself), bounded by __task_stacks_start__ /
+ * __task_stacks_end__ in link_rpi2.ld, each above an MMU guard page when
+ * configUSE_STACK_GUARD is set. TCBs live in .task_tcbs
+ * (__task_tcbs_start__ / __task_tcbs_end__), cleared with .bss.
+ */
+
+#ifndef APP_TASKS_H
+#define APP_TASKS_H
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Cortex-A53 cache line - TCBs and stacks never share a line */
+#define APP_TASK_ALIGN      64
+
+/*
+ * With configUSE_STACK_GUARD every stack sits on a page boundary with
+ * one page below it that mmu_guard_stack() unmaps (mmu.h). Without it
+ * the guard member is empty and stacks are only cache-line aligned.
+ */
+#if configUSE_STACK_GUARD
+#include "mmu.h"
+#define APP_TASK_GUARD_SIZE     MMU_PAGE_SIZE
+#define APP_TASK_STACK_ALIGN    MMU_PAGE_SIZE
+#else
+#define APP_TASK_GUARD_SIZE     0
+#define APP_TASK_STACK_ALIGN    APP_TASK_ALIGN
+#endif
+
+/* Placement of statically allocated task stacks and TCBs */
+#ifndef HOST_SIM
+#define APP_TASK_STACK_SECTION \
+    __attribute__((section(".task_stacks"), aligned(APP_TASK_STACK_ALIGN)))
+#define APP_TASK_TCB_SECTION \
+    __attribute__((section(".task_tcbs"), aligned(APP_TASK_ALIGN)))
+#else
+/* No linker script on the host - GNU ld brackets C-identifier sections itself */
+#define APP_TASK_STACK_SECTION \
+    __attribute__((section("task_stacks"), aligned(APP_TASK_STACK_ALIGN)))
+#define APP_TASK_TCB_SECTION \
+    __attribute__((section("task_tcbs"), aligned(APP_TASK_ALIGN)))
+#endif
+
+/* Idle task stack, words - the timer daemon's is configTIMER_TASK_STACK_DEPTH */
+#ifdef MEMSTAT_STACK_IDLE
+#define IDLE_TASK_STACK_DEPTH   MEMSTAT_STACK_IDLE      /* From a memstat report (memstat.h) */
+#else
+#define IDLE_TASK_STACK_DEPTH   configMINIMAL_STACK_SIZE
+#endif
+
+/* Stack storage with its guard page directly below - use name.stack */
+#define APP_TASK_STACK(name, depth) \
+    static struct { \
+        uint8_t guard[APP_TASK_GUARD_SIZE]; \
+        StackType_t stack[(depth)]; \
+    } name APP_TASK_STACK_SECTION
+
+/* TCB storage in .task_tcbs */
+#define APP_TASK_TCB(name) \
+    static StaticTask_t name APP_TASK_TCB_SECTION
+
+/* Unmap the guard below an APP_TASK_STACK() (no-op without configUSE_STACK_GUARD) */
+#if configUSE_STACK_GUARD
+#define APP_TASK_GUARD(stack, owner)    mmu_guard_stack((stack), (owner))
+#else
+#define APP_TASK_GUARD(stack, owner)    ((void)(stack), (void)(owner), 0)
+#endif
+
+/* app_task_t.flags */
+#define APP_TASK_FPU        (1u << 0)   /* Task has an FPU context from its first instruction */
+
+typedef struct {
+    TaskFunction_t function;
+    const char *name;
+    const char *symbol;         /* Function name - for MEMSTAT_STACK_<symbol> (memstat.h) */
+    uint32_t stack_depth;       /* Words, as for xTaskCreate */
+    UBaseType_t priority;
+    StackType_t *stack;
+    StaticTask_t *tcb;
+    TaskHandle_t *handle;       /* Filled in by app_tasks_create_all() */
+    uint32_t flags;             /* APP_TASK_* */
+} app_task_t;
+
+/*
+ * Declare a boot-time task at file scope:
+ *   APP_TASK(vPLCMain, "PLC", configMINIMAL_STACK_SIZE * 2, 2, 0);
+ * The task handle is available afterwards as vPLCMain_handle. Pass the
+ * depth as MEMSTAT_STACK_<fn> with the current size as its #ifndef
+ * default, and a memstat report (memstat.h) can resize the stack.
+ *
+ * Tasks without APP_TASK_FPU still get an FPU context on their first
+ * VFP/NEON instruction (lazy trap, see fpu.h); the flag only avoids the trap.
+ *
+ * The descriptor's alignment is pinned to the struct's own: x86-64 GCC
+ * raises large objects to 32 bytes, which pads between entries and
+ * breaks the section walk in the host build.
+ */
+#define APP_TASK(fn, task_name, depth, prio, task_flags) \
+    APP_TASK_STACK(fn##_stack, (depth)); \
+    APP_TASK_TCB(fn##_tcb); \
+    TaskHandle_t fn##_handle; \
+    static const app_task_t fn##_desc \
+        __attribute__((section("app_tasks"), used, aligned(__alignof__(app_task_t)))) = \
+        { fn, task_name, #fn, (depth), (prio), fn##_stack.stack, &fn##_tcb, &fn##_handle, (task_flags) }
+
+/* Create every APP_TASK() in the image; returns the number created */
+unsigned int app_tasks_create_all(void);
+
+/* Print each table entry's stack/TCB placement and size on the UART */
+void app_tasks_print_map(void);
+
+/* Table entry of a created task, or NULL if it is not an APP_TASK() */
+const app_task_t *app_tasks_find(TaskHandle_t handle);
+
+#endif /* APP_TASKS_H */
@@ -0,0 +1,39 @@
+/*
+ * BCM2837 GPIO Register Definitions
+ *
+ * 54 pins in two banks at 0x3F200000. Per-bank registers are indexed by
+ * bank (pins 0-31, 32-53); GPFSEL holds 10 pins per register. GPSET,
+ * GPCLR and GPEDS are write-1 registers - GPEDS bits clear when written.
+ * Shared by gpio.c and the host tests that drive it on the mmio.h mock.
+ */
+
+#ifndef BCM2837_GPIO_H
+#define BCM2837_GPIO_H
+
+#include <stdint.h>
+#include "mmio.h"
+
+/* GPIO registers - BCM2837 uses 0x3F000000 peripheral base */
+#define GPIO_BASE       0x3F200000
+
+/* Register addresses - pass to mmio_read()/mmio_write() */
+#define GPFSEL(n)       (GPIO_BASE + 0x00 + (n) * 4)  /* Function select, 10 pins each */
+#define GPSET(b)        (GPIO_BASE + 0x1C + (b) * 4)  /* Output set */
+#define GPCLR(b)        (GPIO_BASE + 0x28 + (b) * 4)  /* Output clear */
+#define GPLEV(b)        (GPIO_BASE + 0x34 + (b) * 4)  /* Pin level */
+#define GPEDS(b)        (GPIO_BASE + 0x40 + (b) * 4)  /* Event detect status */
+#define GPREN(b)        (GPIO_BASE + 0x4C + (b) * 4)  /* Rising edge detect */
+#define GPFEN(b)        (GPIO_BASE + 0x58 + (b) * 4)  /* Falling edge detect */
+#define GPAREN(b)       (GPIO_BASE + 0x7C + (b) * 4)  /* Async rising edge detect */
+#define GPAFEN(b)       (GPIO_BASE + 0x88 + (b) * 4)  /* Async falling edge detect */
+#define GPPUD           (GPIO_BASE + 0x94)            /* Pull-up/down control */
+#define GPPUDCLK(b)     (GPIO_BASE + 0x98 + (b) * 4)  /* Pull-up/down clock */
+
+/* GPFSEL slot of a pin: 3 bits, 10 pins per register */
+#define GPFSEL_WIDTH    3
+
+/* Bank and bit of a pin in the per-bank registers */
+#define GPIO_BANK(pin)  ((pin) >> 5)
+#define GPIO_BIT(pin)   (1u << ((pin) & 31))
+
+#endif /* BCM2837_GPIO_H */
@@ -10,6 +10,7 @@
 #define BCM2837_IRQ_H
 
 #include <stdint.h>
+#include "mmio.h"
 
 /* ========== ARM Local Peripherals (QA7) - Base 0x40000000 ========== */
 /* Per-core interrupt controller and local timers */
@@ -61,18 +62,24 @@
 #define ARM_LOCAL_FIQ_PENDING3      0x7C
 
 /* Local timer control bits */
-#define ARM_LOCAL_TIMER_CTRL_RELOAD_SHIFT   0
-#define ARM_LOCAL_TIMER_CTRL_RELOAD_MASK    0x0FFFFFFF
+#define ARM_LOCAL_TIMER_CTRL_RELOAD         MMIO_FIELD(0, 28)     /* Field - see mmio.h */
 #define ARM_LOCAL_TIMER_CTRL_INT_ENABLE     (1 << 29)
 #define ARM_LOCAL_TIMER_CTRL_INT_FLAG       (1 << 31)
 #define ARM_LOCAL_TIMER_CTRL_ENABLE         (1 << 28)
 
 /* Core timer interrupt control bits */
-#define ARM_LOCAL_TIMER_INT_nCNTPNSIRQ  (1 << 0)  /* Physical non-secure timer */
-#define ARM_LOCAL_TIMER_INT_nCNTPSIRQ   (1 << 1)  /* Physical secure timer */
+#define ARM_LOCAL_TIMER_INT_nCNTPSIRQ   (1 << 0)  /* Physical secure timer */
+#define ARM_LOCAL_TIMER_INT_nCNTPNSIRQ  (1 << 1)  /* Physical non-secure timer (CNTP_* after HYP exit) */
 #define ARM_LOCAL_TIMER_INT_nCNTHPIRQ   (1 << 2)  /* Hypervisor timer */
 #define ARM_LOCAL_TIMER_INT_nCNTVIRQ    (1 << 3)  /* Virtual timer */
 
+/* Core IRQ/FIQ pending (source) register bits */
+#define ARM_LOCAL_IRQ_SRC_CNTPS     (1 << 0)  /* Physical secure timer */
+#define ARM_LOCAL_IRQ_SRC_CNTPNS    (1 << 1)  /* Physical non-secure timer */
+#define ARM_LOCAL_IRQ_SRC_CNTHP     (1 << 2)  /* Hypervisor timer */
+#define ARM_LOCAL_IRQ_SRC_CNTV      (1 << 3)  /* Virtual timer */
+#define ARM_LOCAL_IRQ_SRC_GPU       (1 << 8)  /* VideoCore interrupt controller */
+
 
 /* ========== VideoCore Interrupt Controller - Base 0x3F00B000 ========== */
 /* Handles GPU and peripheral interrupts (UART, GPIO, Timer, etc.) */
@@ -96,6 +103,7 @@
 #define IRQ_SYSTEM_TIMER_1          1
 #define IRQ_SYSTEM_TIMER_2          2
 #define IRQ_SYSTEM_TIMER_3          3
+#define IRQ_DMA_0                   16   /* DMA channel n is IRQ_DMA_0 + n (0-12) */
 #define IRQ_AUX                     29   /* UART1, SPI1, SPI2 */
 
 /* Interrupt numbers for IRQ_ENABLE_2 / IRQ_PENDING_2 (32-63) */
@@ -125,25 +133,74 @@
 
 /* Read from ARM local peripheral register */
 #define ARM_LOCAL_REG(offset) \
-    (*(volatile uint32_t *)(ARM_LOCAL_BASE + (offset)))
+    mmio_read(ARM_LOCAL_BASE + (offset))
 
 /* Write to ARM local peripheral register */
 #define ARM_LOCAL_WRITE(offset, value) \
-    do { *(volatile uint32_t *)(ARM_LOCAL_BASE + (offset)) = (value); } while(0)
+    mmio_write(ARM_LOCAL_BASE + (offset), (value))
 
 /* Read from VideoCore interrupt controller */
 #define IRQ_VC_REG(offset) \
-    (*(volatile uint32_t *)(IRQ_VC_BASE + (offset)))
+    mmio_read(IRQ_VC_BASE + (offset))
 
 /* Write to VideoCore interrupt controller */
 #define IRQ_VC_WRITE(offset, value) \
-    do { *(volatile uint32_t *)(IRQ_VC_BASE + (offset)) = (value); } while(0)
+    mmio_write(IRQ_VC_BASE + (offset), (value))
 
 /* Core-specific register access (for multi-core) */
 #define ARM_LOCAL_CORE_REG(core, base_offset) \
     ARM_LOCAL_REG((base_offset) + ((core) * 4))
 
 
+/* ========== Interrupt Controller Functions (rpi2_support.c) ========== */
+
+/* Number of VideoCore interrupt sources (IRQ_PENDING_1 + IRQ_PENDING_2) */
+#define BCM2837_VC_IRQ_COUNT    64
+
+/* Peripheral IRQ handler - runs in IRQ mode, integer-only, FromISR APIs only */
+typedef void (*bcm2837_irq_handler_t)(void *context);
+
+void bcm2837_irq_init(void);
+void bcm2837_enable_vc_irq(uint32_t irq_num);
+void bcm2837_disable_vc_irq(uint32_t irq_num);
+
+/* Install the handler for VideoCore IRQ irq_num (does not enable it) */
+void bcm2837_irq_register(uint32_t irq_num, bcm2837_irq_handler_t handler, void *context);
+
+/*
+ * Per-source interrupt statistics (configUSE_IRQ_STATS), in CNTPCT ticks.
+ * Sources are the VideoCore IRQ numbers plus BCM2837_IRQ_STATS_TICK for
+ * the FreeRTOS tick. Latency is measured from the compare match to IRQ
+ * entry for the tick, and from IRQ entry to the handler call for
+ * VideoCore sources (time spent behind other sources in the same IRQ).
+ */
+#define BCM2837_IRQ_STATS_TICK  BCM2837_VC_IRQ_COUNT
+#define BCM2837_IRQ_STATS_COUNT (BCM2837_VC_IRQ_COUNT + 1)
+
+typedef struct {
+    uint32_t count;
+    uint32_t latency_max;
+    uint64_t latency_total;
+    uint32_t run_max;               /* Handler execution */
+    uint64_t run_total;
+} bcm2837_irq_stats_t;
+
+/* Copy one source's figures; returns 0 for an unknown source */
+int bcm2837_irq_get_stats(uint32_t source, bcm2837_irq_stats_t *stats);
+
+/* Zero every source */
+void bcm2837_irq_stats_reset(void);
+
+#ifdef HOST_SIM
+/*
+ * Host simulation (Source/host/host_support.c): run the handler of an
+ * enabled source in the calling task, as if it had fired. Set up the
+ * source's registers with mmio_mock_poke() first. Returns 0 if nothing ran.
+ */
+int host_irq_raise(uint32_t irq_num);
+#endif
+
+
 /* ========== FreeRTOS ARM_CA9 Port Compatibility Layer ========== */
 /*
  * The FreeRTOS ARM_CA9 port expects ARM GIC registers.
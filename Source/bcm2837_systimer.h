@@ -0,0 +1,45 @@
+/*
+ * BCM2837 System Timer Definitions
+ *
+ * Free-running 64-bit 1 MHz counter with four 32-bit compare channels at
+ * configTIMER_BASE (0x3F003000). Channels 0 and 2 are used by the GPU
+ * firmware; channels 1 and 3 are free for the ARM. A match sets the
+ * channel's CS bit and raises IRQ_SYSTEM_TIMER_n until the bit is cleared
+ * by writing 1 to it.
+ */
+
+#ifndef BCM2837_SYSTIMER_H
+#define BCM2837_SYSTIMER_H
+
+#include <stdint.h>
+#include "mmio.h"
+
+#define SYSTIMER_BASE           0x3F003000
+
+/* Register offsets from SYSTIMER_BASE */
+#define SYSTIMER_CS             0x00    /* Control/status - match flags */
+#define SYSTIMER_CLO            0x04    /* Counter low 32 bits */
+#define SYSTIMER_CHI            0x08    /* Counter high 32 bits */
+#define SYSTIMER_C0             0x0C    /* Compare 0 (GPU) */
+#define SYSTIMER_C1             0x10    /* Compare 1 */
+#define SYSTIMER_C2             0x14    /* Compare 2 (GPU) */
+#define SYSTIMER_C3             0x18    /* Compare 3 */
+
+/* Compare register offset for channel n */
+#define SYSTIMER_CMP(n)         (SYSTIMER_C0 + ((n) * 4))
+
+/* CS match flag for channel n (write 1 to clear) */
+#define SYSTIMER_CS_MATCH(n)    (1 << (n))
+
+/* Counter frequency */
+#define SYSTIMER_HZ             1000000u
+
+/* Read from system timer register */
+#define SYSTIMER_REG(offset) \
+    mmio_read(SYSTIMER_BASE + (offset))
+
+/* Write to system timer register */
+#define SYSTIMER_WRITE(offset, value) \
+    mmio_write(SYSTIMER_BASE + (offset), (value))
+
+#endif /* BCM2837_SYSTIMER_H */
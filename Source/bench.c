@@ -0,0 +1,716 @@
+/*
+ * Micro-benchmark suite for RPi2 BCM2837
+ *
+ * Samples are timed with the PMU cycle counter. Single-operation samples
+ * run with IRQs masked so tick and peripheral interrupts do not land
+ * inside a measurement, except where the code under test goes through
+ * the port's critical sections, which unmask them (heap_4, queues) -
+ * those say so and report min as the figure to compare. Scheduler
+ * benchmarks run with IRQs enabled.
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "bench.h"
+#include "cpu.h"
+#include "pool.h"
+#include "msg.h"
+#include "fpu.h"
+#include "fiq.h"
+#include "spi.h"
+#include "dma.h"
+#include "hrtimer.h"
+#include "trace.h"
+#include <string.h>     /* memcpy/memset prototypes - implemented in rpi2_support.c */
+#include "uart.h"
+
+typedef struct {
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t count;
+} bench_stat_t;
+
+static void bench_stat_reset(bench_stat_t *st) {
+    st->min = 0xFFFFFFFF;
+    st->max = 0;
+    st->total = 0;
+    st->count = 0;
+}
+
+static void bench_stat_add(bench_stat_t *st, uint32_t cycles) {
+    if (cycles < st->min) st->min = cycles;
+    if (cycles > st->max) st->max = cycles;
+    st->total += cycles;
+    st->count++;
+}
+
+static void bench_report(const char *name, uint32_t param, const bench_stat_t *st) {
+    uint32_t avg = st->count ? (uint32_t)(st->total / st->count) : 0;
+    uart_printf("  %s(%u): min %u avg %u max %u cycles\n", name, param, st->min, avg, st->max);
+}
+
+/* ========== Pool Allocator ========== */
+
+static void bench_pool_pairs(size_t size) {
+    bench_stat_t st;
+
+    bench_stat_reset(&st);
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        uint32_t cpsr = cpu_irq_save();
+        uint32_t t0 = cpu_cycles();
+        pool_free(pool_alloc(size));
+        bench_stat_add(&st, cpu_cycles() - t0);
+        cpu_irq_restore(cpsr);
+    }
+    bench_report("pool_alloc+pool_free", size, &st);
+
+    /*
+     * heap_4 locks with vTaskSuspendAll/xTaskResumeAll, and the port's
+     * critical section inside xTaskResumeAll unmasks IRQs - masking them
+     * here would not hold. The scheduler is suspended instead, so the
+     * heap's own resume is nested and never switches; interrupts still
+     * land in the sample, so min is the figure to compare with the pool.
+     */
+    bench_stat_reset(&st);
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        vTaskSuspendAll();
+        uint32_t t0 = cpu_cycles();
+        vPortFree(pvPortMalloc(size));
+        bench_stat_add(&st, cpu_cycles() - t0);
+        xTaskResumeAll();
+    }
+    bench_report("pvPortMalloc+vPortFree (scheduler suspended)", size, &st);
+}
+
+void bench_pool(void) {
+    static const size_t sizes[] = { 64, 256, 1024, 4096 };
+    static void *held[64];
+
+    uart_puts("=== BENCH: pool vs heap_4 (alloc/free pairs) ===\r\n");
+    for (unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        bench_pool_pairs(sizes[i]);
+    }
+
+    /* Leave 32 small holes at the front of the heap_4 free list so the
+     * first-fit walk has to step over them, as it does after uptime */
+    uart_puts("--- heap_4 with 32 free-list holes ---\r\n");
+    for (int i = 0; i < 64; i++) {
+        held[i] = pvPortMalloc((i & 1) ? 200 : 48);
+    }
+    for (int i = 0; i < 64; i += 2) {
+        vPortFree(held[i]);
+    }
+    for (unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        bench_pool_pairs(sizes[i]);
+    }
+    for (int i = 1; i < 64; i += 2) {
+        vPortFree(held[i]);
+    }
+
+    pool_print_stats();
+}
+
+/* ========== Context Switch ========== */
+
+static TaskHandle_t bench_main_task;
+
+/* Higher-priority echo task: each notification from the bench task is
+ * answered straight back, so one round trip is two context switches */
+static void bench_echo_task(void *pvParameters) {
+    if (pvParameters != NULL) {
+        portTASK_USES_FLOATING_POINT();
+    }
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        xTaskNotifyGive(bench_main_task);
+    }
+}
+
+static void bench_switch_pair(const char *name, int with_fpu) {
+    TaskHandle_t echo;
+    bench_stat_t st;
+
+    bench_main_task = xTaskGetCurrentTaskHandle();
+    xTaskCreate(bench_echo_task, "BenchEcho", configMINIMAL_STACK_SIZE, with_fpu ? (void *)1 : NULL,
+                configMAX_PRIORITIES - 2, &echo);
+
+    bench_stat_reset(&st);
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        uint32_t t0 = cpu_cycles();
+        xTaskNotifyGive(echo);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        bench_stat_add(&st, (cpu_cycles() - t0) / 2);
+    }
+    bench_report(name, with_fpu, &st);
+
+    vTaskDelete(echo);
+}
+
+void bench_context_switch(void) {
+    uart_puts("=== BENCH: context switch (notify round trip / 2) ===\r\n");
+    bench_switch_pair("switch, integer-only tasks", 0);
+
+    /* The FPU run must come last: the bench task keeps its FPU context */
+    portTASK_USES_FLOATING_POINT();
+    bench_switch_pair("switch, FPU context (D0-D31)", 1);
+    uart_printf("  lazy FPU traps so far: %u\n", fpu_lazy_trap_count);
+}
+
+/* ========== FIQ Fast Path ========== */
+
+#define BENCH_FIQ_PERIOD_US     100
+/* Give up after four times the nominal run - no FIQ route, or a stuck timer */
+#define BENCH_FIQ_TIMEOUT_US    (BENCH_ITERATIONS * BENCH_FIQ_PERIOD_US * 4)
+
+void bench_fiq(void) {
+    const uint32_t expected = (CPU_CNTPCT_HZ / 1000000) * BENCH_FIQ_PERIOD_US;
+    uint32_t latency_hist[4] = { 0, 0, 0, 0 };  /* <250 ns, <500 ns, <1 us, >=1 us */
+    uint32_t prev_stamp = 0;
+    bench_stat_t latency;
+    bench_stat_t jitter;
+    fiq_event_t ev;
+    uint64_t deadline;
+    int events = 0;
+
+    uart_puts("=== BENCH: FIQ fast path (system timer C1) ===\r\n");
+    bench_stat_reset(&latency);
+    bench_stat_reset(&jitter);
+
+    /* Drain anything left over, then collect BENCH_ITERATIONS events */
+    while (fiq_ring_pop(&ev)) {}
+    fiq_systimer_start(BENCH_FIQ_PERIOD_US);
+    deadline = cpu_cntpct() + (uint64_t)(CPU_CNTPCT_HZ / 1000000) * BENCH_FIQ_TIMEOUT_US;
+
+    while (events < BENCH_ITERATIONS) {
+        if (!fiq_ring_pop(&ev)) {
+            if (cpu_cntpct() > deadline) {
+                break;
+            }
+            continue;
+        }
+        /* CNTPCT ticks from the compare match to FIQ entry */
+        uint32_t ticks = fiq_systimer_latency(&ev);
+        uint32_t ns = ticks * 625 / 12;
+        bench_stat_add(&latency, ticks);
+        latency_hist[ns < 250 ? 0 : ns < 500 ? 1 : ns < 1000 ? 2 : 3]++;
+        if (events > 0) {
+            /* Deviation of the entry-to-entry interval from the period */
+            uint32_t interval = ev.stamp - prev_stamp;
+            bench_stat_add(&jitter, interval > expected ? interval - expected : expected - interval);
+        }
+        prev_stamp = ev.stamp;
+        events++;
+    }
+
+    fiq_systimer_stop();
+
+    if (events < BENCH_ITERATIONS) {
+        uart_printf("  FAILED: %d of %u FIQ events in %u ms, ring drops %u\n", events,
+                    (uint32_t)BENCH_ITERATIONS, (uint32_t)(BENCH_FIQ_TIMEOUT_US / 1000),
+                    fiq_ring_dropped());
+        return;
+    }
+
+    uart_printf("  match-to-entry latency (CNTPCT, 52ns units): min %u avg %u max %u\n",
+                latency.min, (uint32_t)(latency.total / latency.count), latency.max);
+    uart_printf("  <250ns %u, <500ns %u, <1us %u, >=1us %u\n",
+                latency_hist[0], latency_hist[1], latency_hist[2], latency_hist[3]);
+    uart_printf("  entry jitter (CNTPCT, 52ns units): min %u avg %u max %u\n",
+                jitter.min, (uint32_t)(jitter.total / jitter.count), jitter.max);
+    uart_printf("  ring drops: %u\n", fiq_ring_dropped());
+}
+
+/* ========== SPI Transactions ========== */
+
+/*
+ * Needs MOSI (GPIO 10) looped back to MISO (GPIO 9); without the jumper
+ * the timings are still valid but every byte is reported as a mismatch.
+ * Latency is submit-to-completion from the per-record CNTPCT stamps.
+ */
+
+#define BENCH_SPI_HZ            10000000
+#define BENCH_SPI_MAX_LEN       1024
+#define BENCH_SPI_BATCH         8
+#define BENCH_SPI_ROUNDS        100
+
+static uint8_t bench_spi_tx[BENCH_SPI_MAX_LEN] __attribute__((aligned(4)));
+static uint8_t bench_spi_rx[BENCH_SPI_MAX_LEN] __attribute__((aligned(4)));
+
+static void bench_spi_report(const char *name, uint32_t param, const bench_stat_t *st,
+                             uint32_t mismatches) {
+    uint32_t avg = st->count ? (uint32_t)(st->total / st->count) : 0;
+    uart_printf("  %s(%u): min %u avg %u max %u us, %u mismatches\n", name, param,
+                cpu_cntpct_to_us(st->min), cpu_cntpct_to_us(avg), cpu_cntpct_to_us(st->max),
+                mismatches);
+}
+
+static uint32_t bench_spi_check(uint32_t offset, uint32_t len) {
+    uint32_t bad = 0;
+    for (uint32_t i = 0; i < len; i++) {
+        if (bench_spi_rx[offset + i] != bench_spi_tx[offset + i]) {
+            bad++;
+        }
+    }
+    return bad;
+}
+
+static void bench_spi_single(const spi_device_t *dev, uint32_t len) {
+    spi_xfer_t x = { 0 };
+    bench_stat_t st;
+    uint32_t bad = 0;
+
+    x.dev = dev;
+    x.tx = bench_spi_tx;
+    x.rx = bench_spi_rx;
+    x.len = len;
+
+    bench_stat_reset(&st);
+    for (int i = 0; i < BENCH_SPI_ROUNDS; i++) {
+        if (spi_transfer(&x, pdMS_TO_TICKS(100)) != SPI_XFER_OK) {
+            uart_printf("  spi_transfer(%u) failed: %d\n", len, x.status);
+            return;
+        }
+        bench_stat_add(&st, spi_xfer_latency_ticks(&x));
+        bad += bench_spi_check(0, len);
+    }
+    bench_spi_report(len >= SPI_DMA_THRESHOLD ? "spi_transfer DMA" : "spi_transfer FIFO",
+                     len, &st, bad);
+}
+
+/* One submission of BENCH_SPI_BATCH records, as a PLC scan would issue */
+static void bench_spi_batch(const spi_device_t *dev, uint32_t len) {
+    spi_xfer_t x[BENCH_SPI_BATCH] = { 0 };
+    bench_stat_t st;
+    uint32_t bad = 0;
+
+    for (int i = 0; i < BENCH_SPI_BATCH; i++) {
+        x[i].next = (i + 1 < BENCH_SPI_BATCH) ? &x[i + 1] : NULL;
+        x[i].dev = dev;
+        x[i].tx = bench_spi_tx + i * len;
+        x[i].rx = bench_spi_rx + i * len;
+        x[i].len = len;
+    }
+
+    bench_stat_reset(&st);
+    for (int r = 0; r < BENCH_SPI_ROUNDS; r++) {
+        if (spi_transfer(x, pdMS_TO_TICKS(100)) != SPI_XFER_OK) {
+            uart_puts("  spi batch failed\r\n");
+            return;
+        }
+        bench_stat_add(&st, spi_xfer_latency_ticks(&x[BENCH_SPI_BATCH - 1]));
+        bad += bench_spi_check(0, len * BENCH_SPI_BATCH);
+    }
+    bench_spi_report("spi batch of 8, whole batch", len, &st, bad);
+}
+
+void bench_spi(void) {
+    spi_device_t dev = { 0, 0, spi_clk_div(BENCH_SPI_HZ) };
+
+    uart_puts("=== BENCH: SPI0 transactions (MOSI-MISO loopback) ===\r\n");
+    for (int i = 0; i < BENCH_SPI_MAX_LEN; i++) {
+        bench_spi_tx[i] = (uint8_t)(i * 7 + 1);
+    }
+
+    bench_spi_single(&dev, 4);
+    bench_spi_single(&dev, 64);
+    bench_spi_single(&dev, 256);
+    bench_spi_single(&dev, BENCH_SPI_MAX_LEN);
+    bench_spi_batch(&dev, 16);
+}
+
+/* ========== DMA Memory Service ========== */
+
+#define BENCH_DMA_MAX_LEN       (1024 * 1024)
+
+/* Cycles to MB/s at configCPU_CLOCK_HZ */
+static uint32_t bench_mbps(uint32_t bytes, uint32_t cycles) {
+    return cycles ? (uint32_t)(((uint64_t)bytes * (configCPU_CLOCK_HZ / 1000000)) / cycles) : 0;
+}
+
+static void bench_dma_size(uint8_t *dst, const uint8_t *src, uint32_t len) {
+    uint32_t t0, cpu_copy, cpu_set, dma_copy, dma_set, submit;
+    dma_op_t op = { 0 };
+
+    t0 = cpu_cycles();
+    memcpy(dst, src, len);
+    cpu_copy = cpu_cycles() - t0;
+
+    t0 = cpu_cycles();
+    memset(dst, 0x5A, len);
+    cpu_set = cpu_cycles() - t0;
+
+    t0 = cpu_cycles();
+    dma_memcpy(dst, src, len);
+    dma_copy = cpu_cycles() - t0;
+
+    t0 = cpu_cycles();
+    dma_memset(dst, 0x5A, len);
+    dma_set = cpu_cycles() - t0;
+
+    /* CPU time actually spent on an async request: building and queueing it */
+    op.notify = xTaskGetCurrentTaskHandle();
+    ulTaskNotifyTakeIndexed(configDRIVER_NOTIFY_INDEX, pdTRUE, 0);
+    t0 = cpu_cycles();
+    int queued = dma_memcpy_async(&op, dst, src, len);
+    submit = cpu_cycles() - t0;
+    if (queued == DMA_OP_PENDING) {
+        ulTaskNotifyTakeIndexed(configDRIVER_NOTIFY_INDEX, pdTRUE, portMAX_DELAY);
+    }
+
+    uart_printf("  %u bytes: memcpy CPU %u MB/s DMA %u MB/s, memset CPU %u MB/s DMA %u MB/s\n",
+                len, bench_mbps(len, cpu_copy), bench_mbps(len, dma_copy),
+                bench_mbps(len, cpu_set), bench_mbps(len, dma_set));
+    uart_printf("  %u bytes: async submit %u cycles, transfer %u us\n",
+                len, submit, cpu_cntpct_to_us(op.t_done - op.t_submit));
+}
+
+/*
+ * Two-CB dma_submit() chain with DMA_TI_INTEN on both CBs. The first
+ * CB's interrupt must not retire the op: the done callback checks that
+ * the second CB's last word is already in place when it runs.
+ */
+#define BENCH_DMA_CHAIN_HALF    (256 * 1024)
+
+static dma_cb_t bench_dma_cbs[2];
+static const uint32_t *bench_dma_chain_src;
+static const volatile uint32_t *bench_dma_chain_dst;
+static volatile uint32_t bench_dma_chain_calls;
+static volatile uint32_t bench_dma_chain_tail_ok;
+
+static void bench_dma_chain_done(dma_op_t *op) {
+    uint32_t last = 2 * BENCH_DMA_CHAIN_HALF / sizeof(uint32_t) - 1;
+
+    (void)op;
+    bench_dma_chain_calls++;
+    bench_dma_chain_tail_ok = bench_dma_chain_dst[last] == bench_dma_chain_src[last];
+}
+
+static void bench_dma_chain(uint8_t *dst, const uint8_t *src) {
+    dma_op_t op = { 0 };
+
+    memset(dst, 0, 2 * BENCH_DMA_CHAIN_HALF);
+    bench_dma_chain_src = (const uint32_t *)src;
+    bench_dma_chain_dst = (const volatile uint32_t *)dst;
+    bench_dma_chain_calls = 0;
+    bench_dma_chain_tail_ok = 0;
+
+    for (uint32_t i = 0; i < 2; i++) {
+        bench_dma_cbs[i].ti = DMA_TI_SRC_INC | DMA_TI_DEST_INC | DMA_TI_WAIT_RESP |
+                              DMA_TI_INTEN | DMA_TI_BURST(4);
+        bench_dma_cbs[i].source_ad = dma_bus_addr(src + i * BENCH_DMA_CHAIN_HALF);
+        bench_dma_cbs[i].dest_ad = dma_bus_addr(dst + i * BENCH_DMA_CHAIN_HALF);
+        bench_dma_cbs[i].txfr_len = BENCH_DMA_CHAIN_HALF;
+        bench_dma_cbs[i].stride = 0;
+    }
+    dma_cb_link(&bench_dma_cbs[0], &bench_dma_cbs[1]);
+    dma_cb_link(&bench_dma_cbs[1], NULL);
+
+    op.chain = bench_dma_cbs;
+    op.done = bench_dma_chain_done;
+    op.notify = xTaskGetCurrentTaskHandle();
+    ulTaskNotifyTakeIndexed(configDRIVER_NOTIFY_INDEX, pdTRUE, 0);
+    if (dma_submit(&op) != DMA_OP_PENDING ||
+        !ulTaskNotifyTakeIndexed(configDRIVER_NOTIFY_INDEX, pdTRUE, pdMS_TO_TICKS(100))) {
+        uart_printf("  chain: FAILED, status %d\n", op.status);
+        return;
+    }
+
+    uint32_t bad = 0;
+    for (uint32_t i = 0; i < 2 * BENCH_DMA_CHAIN_HALF; i++) {
+        if (dst[i] != src[i]) {
+            bad++;
+        }
+    }
+    uart_printf("  chain (2 CBs, INTEN on both): %s - %u completion(s), tail %s at completion, "
+                "%u mismatches, %u us\n",
+                (op.status == DMA_OP_OK && bench_dma_chain_calls == 1 &&
+                 bench_dma_chain_tail_ok && bad == 0) ? "ok" : "FAILED",
+                bench_dma_chain_calls, bench_dma_chain_tail_ok ? "written" : "missing",
+                bad, cpu_cntpct_to_us(op.t_done - op.t_submit));
+}
+
+void bench_dma(void) {
+    uart_puts("=== BENCH: DMA memcpy/memset vs CPU ===\r\n");
+
+    uint8_t *src = pvPortMalloc(BENCH_DMA_MAX_LEN);
+    uint8_t *dst = pvPortMalloc(BENCH_DMA_MAX_LEN);
+    if (src == NULL || dst == NULL) {
+        uart_puts("  buffer allocation failed\r\n");
+        vPortFree(src);
+        vPortFree(dst);
+        return;
+    }
+
+    for (uint32_t i = 0; i < BENCH_DMA_MAX_LEN; i++) {
+        src[i] = (uint8_t)(i * 13 + 7);
+    }
+
+    bench_dma_size(dst, src, 4096);
+    bench_dma_size(dst, src, 64 * 1024);
+    bench_dma_size(dst, src, BENCH_DMA_MAX_LEN);
+
+    uint32_t bad = 0;
+    dma_memcpy(dst, src, BENCH_DMA_MAX_LEN);
+    for (uint32_t i = 0; i < BENCH_DMA_MAX_LEN; i++) {
+        if (dst[i] != src[i]) {
+            bad++;
+        }
+    }
+    uart_printf("  verify: %u mismatches\n", bad);
+
+    bench_dma_chain(dst, src);
+
+    vPortFree(src);
+    vPortFree(dst);
+}
+
+/* ========== High-Resolution Timers ========== */
+
+#define BENCH_HRTIMER_PERIOD_US     200
+#define BENCH_HRTIMER_ONESHOTS      16
+/* Four times the nominal periodic run */
+#define BENCH_HRTIMER_TIMEOUT_MS    (BENCH_ITERATIONS * BENCH_HRTIMER_PERIOD_US * 4 / 1000)
+
+static volatile uint32_t bench_hrt_fired;
+static volatile uint64_t bench_hrt_next;
+static bench_stat_t bench_hrt_late;
+static volatile uint32_t bench_hrt_order_errors;
+static volatile uint32_t bench_hrt_last_delay;
+
+/* Periodic, IRQ context: lateness against the ideal grid */
+static void bench_hrt_periodic(hrtimer_t *timer, void *context) {
+    uint64_t now = hrtimer_now();
+
+    (void)timer;
+    (void)context;
+
+    bench_stat_add(&bench_hrt_late, (uint32_t)(now - bench_hrt_next));
+    bench_hrt_next += BENCH_HRTIMER_PERIOD_US;
+    bench_hrt_fired++;
+}
+
+/* One-shots must expire in delay order */
+static void bench_hrt_oneshot(hrtimer_t *timer, void *context) {
+    uint32_t delay = (uint32_t)context;
+
+    (void)timer;
+
+    if (delay < bench_hrt_last_delay) {
+        bench_hrt_order_errors++;
+    }
+    bench_hrt_last_delay = delay;
+}
+
+void bench_hrtimer(void) {
+    static hrtimer_t periodic;
+    static hrtimer_t oneshots[BENCH_HRTIMER_ONESHOTS];
+    hrtimer_stats_t stats;
+
+    uart_puts("=== BENCH: hrtimer (system timer C3) ===\r\n");
+
+    bench_stat_reset(&bench_hrt_late);
+    bench_hrt_fired = 0;
+    hrtimer_setup(&periodic, bench_hrt_periodic, NULL, 0);
+
+    uint32_t cpsr = cpu_irq_save();
+    bench_hrt_next = hrtimer_now() + BENCH_HRTIMER_PERIOD_US;
+    hrtimer_start_at(&periodic, bench_hrt_next, BENCH_HRTIMER_PERIOD_US);
+    cpu_irq_restore(cpsr);
+
+    TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(BENCH_HRTIMER_TIMEOUT_MS);
+    while (bench_hrt_fired < BENCH_ITERATIONS &&
+           (int32_t)(xTaskGetTickCount() - deadline) < 0) {
+        vTaskDelay(1);
+    }
+    hrtimer_cancel(&periodic);
+
+    if (bench_hrt_fired < BENCH_ITERATIONS) {
+        uart_printf("  FAILED: periodic fired %u of %u times in %u ms\n", bench_hrt_fired,
+                    (uint32_t)BENCH_ITERATIONS, (uint32_t)BENCH_HRTIMER_TIMEOUT_MS);
+        return;
+    }
+
+    uart_printf("  periodic %uus lateness: min %u avg %u max %u us\n", BENCH_HRTIMER_PERIOD_US,
+                bench_hrt_late.min, (uint32_t)(bench_hrt_late.total / bench_hrt_late.count),
+                bench_hrt_late.max);
+
+    /* Arm in scrambled order, delays 100..1600 us */
+    bench_hrt_last_delay = 0;
+    bench_hrt_order_errors = 0;
+    for (int i = 0; i < BENCH_HRTIMER_ONESHOTS; i++) {
+        uint32_t delay = 100 + ((i * 7) % BENCH_HRTIMER_ONESHOTS) * 100;
+        hrtimer_setup(&oneshots[i], bench_hrt_oneshot, (void *)delay, 0);
+        hrtimer_start(&oneshots[i], delay, 0);
+    }
+    vTaskDelay(pdMS_TO_TICKS(5));
+
+    hrtimer_get_stats(&stats);
+    uart_printf("  one-shot order errors: %u, expiries %u, worst late %u us\n",
+                bench_hrt_order_errors, stats.expiries, stats.late_max_us);
+}
+
+/* ========== Flight Recorder ========== */
+
+void bench_trace(void) {
+    bench_stat_t st;
+
+    uart_puts("=== BENCH: flight recorder ===\r\n");
+
+    bench_stat_reset(&st);
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        uint32_t cpsr = cpu_irq_save();
+        uint32_t t0 = cpu_cycles();
+        trace_event(TRACE_EV_USER, 0, i, 0);
+        bench_stat_add(&st, cpu_cycles() - t0);
+        cpu_irq_restore(cpsr);
+    }
+    bench_report("trace_event", 16, &st);
+}
+
+/* ========== Zero-Copy Messaging ========== */
+
+/*
+ * The same payload moved by value through xQueueSend/xQueueReceive and by
+ * pointer through msg.h. The producer's fill is not timed - both sides
+ * write the payload once, into a source buffer or into the loan. Queue
+ * calls run with IRQs enabled (the port's critical sections re-enable
+ * them), so min is the figure to compare; max includes tick interrupts.
+ */
+
+#define BENCH_MSG_FANOUT        3
+
+static uint8_t bench_msg_src[POOL_MAX_BLOCK] __attribute__((aligned(POOL_ALIGN)));
+static uint8_t bench_msg_sink[POOL_MAX_BLOCK] __attribute__((aligned(POOL_ALIGN)));
+
+/* Higher-priority consumers: each item is taken as soon as it is sent */
+static void bench_msg_copy_task(void *pvParameters) {
+    for (;;) {
+        xQueueReceive((QueueHandle_t)pvParameters, bench_msg_sink, portMAX_DELAY);
+    }
+}
+
+static void bench_msg_loan_task(void *pvParameters) {
+    for (;;) {
+        msg_release(msg_receive((QueueHandle_t)pvParameters, portMAX_DELAY));
+    }
+}
+
+static uint32_t *bench_msg_loan(uint32_t size, uint32_t seq) {
+    uint32_t *buf = msg_loan(size);
+    configASSERT(buf != NULL);
+    buf[0] = seq;
+    return buf;
+}
+
+static void bench_msg_size(uint32_t size) {
+    QueueHandle_t copy_q[BENCH_MSG_FANOUT];
+    QueueHandle_t loan_q[BENCH_MSG_FANOUT];
+    TaskHandle_t consumer;
+    bench_stat_t st;
+
+    for (int q = 0; q < BENCH_MSG_FANOUT; q++) {
+        copy_q[q] = xQueueCreate(1, size);
+        loan_q[q] = msg_channel_create(1);
+        configASSERT(copy_q[q] != NULL && loan_q[q] != NULL);
+    }
+
+    /* Send and receive in one task - the transfer without a switch */
+    bench_stat_reset(&st);
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        uint32_t t0 = cpu_cycles();
+        xQueueSend(copy_q[0], bench_msg_src, 0);
+        xQueueReceive(copy_q[0], bench_msg_sink, 0);
+        bench_stat_add(&st, cpu_cycles() - t0);
+    }
+    bench_report("copy: xQueueSend+xQueueReceive", size, &st);
+
+    bench_stat_reset(&st);
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        uint32_t t0 = cpu_cycles();
+        msg_send(loan_q[0], bench_msg_loan(size, i), 0);
+        msg_release(msg_receive(loan_q[0], 0));
+        bench_stat_add(&st, cpu_cycles() - t0);
+    }
+    bench_report("loan: loan+send+receive+release", size, &st);
+
+    /* Producer to a waiting consumer task - two switches per message */
+    xTaskCreate(bench_msg_copy_task, "BenchMsg", configMINIMAL_STACK_SIZE, copy_q[0],
+                configMAX_PRIORITIES - 2, &consumer);
+    bench_stat_reset(&st);
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        uint32_t t0 = cpu_cycles();
+        xQueueSend(copy_q[0], bench_msg_src, portMAX_DELAY);
+        bench_stat_add(&st, cpu_cycles() - t0);
+    }
+    vTaskDelete(consumer);
+    bench_report("copy: to consumer task", size, &st);
+
+    xTaskCreate(bench_msg_loan_task, "BenchMsg", configMINIMAL_STACK_SIZE, loan_q[0],
+                configMAX_PRIORITIES - 2, &consumer);
+    bench_stat_reset(&st);
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        uint32_t t0 = cpu_cycles();
+        msg_send(loan_q[0], bench_msg_loan(size, i), portMAX_DELAY);
+        bench_stat_add(&st, cpu_cycles() - t0);
+    }
+    vTaskDelete(consumer);
+    bench_report("loan: to consumer task", size, &st);
+
+    /* One payload to BENCH_MSG_FANOUT readers */
+    bench_stat_reset(&st);
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        uint32_t t0 = cpu_cycles();
+        for (int q = 0; q < BENCH_MSG_FANOUT; q++) {
+            xQueueSend(copy_q[q], bench_msg_src, 0);
+        }
+        for (int q = 0; q < BENCH_MSG_FANOUT; q++) {
+            xQueueReceive(copy_q[q], bench_msg_sink, 0);
+        }
+        bench_stat_add(&st, cpu_cycles() - t0);
+    }
+    bench_report("copy: fan-out x3", size, &st);
+
+    bench_stat_reset(&st);
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        uint32_t t0 = cpu_cycles();
+        msg_publish(loan_q, BENCH_MSG_FANOUT, bench_msg_loan(size, i), 0);
+        for (int q = 0; q < BENCH_MSG_FANOUT; q++) {
+            msg_release(msg_receive(loan_q[q], 0));
+        }
+        bench_stat_add(&st, cpu_cycles() - t0);
+    }
+    bench_report("loan: fan-out x3", size, &st);
+
+    for (int q = 0; q < BENCH_MSG_FANOUT; q++) {
+        vQueueDelete(copy_q[q]);
+        vQueueDelete(loan_q[q]);
+    }
+}
+
+void bench_msg(void) {
+    static const uint32_t sizes[] = { 64, 256, 1024, 4096 };
+
+    uart_puts("=== BENCH: queue copy vs zero-copy loan (msg.h) ===\r\n");
+    for (uint32_t i = 0; i < POOL_MAX_BLOCK; i++) {
+        bench_msg_src[i] = (uint8_t)i;
+    }
+    for (unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        bench_msg_size(sizes[i]);
+    }
+}
+
+/* ========== Suite ========== */
+
+void bench_run_all(void) {
+    cpu_cycles_init();
+
+    bench_pool();
+    bench_context_switch();
+    bench_fiq();
+    bench_spi();
+    bench_dma();
+    bench_hrtimer();
+    bench_trace();
+    bench_msg();
+}
@@ -0,0 +1,42 @@
+/*
+ * Micro-benchmark suite for RPi2 BCM2837
+ * Run from the benchmark image (Source/main_bench.c, ./build_bench.sh).
+ * Figures are CPU cycles from the PMU cycle counter unless labelled otherwise.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+
+/* Samples taken per measurement */
+#define BENCH_ITERATIONS    1000
+
+/* Run every benchmark below in order - call from a task */
+void bench_run_all(void);
+
+/* pool_alloc/pool_free pairs vs pvPortMalloc/vPortFree pairs */
+void bench_pool(void);
+
+/* Task-to-task switch cost with and without FPU context (fpu.h) */
+void bench_context_switch(void);
+
+/* FIQ latency and jitter from a system timer compare routed to FIQ (fiq.h) */
+void bench_fiq(void);
+
+/* SPI0 transaction latency, FIFO vs DMA path and batched submission (spi.h) */
+void bench_spi(void);
+
+/* DMA memcpy/memset throughput against the CPU routines (dma.h) */
+void bench_dma(void);
+
+/* hrtimer periodic lateness and one-shot ordering (hrtimer.h) */
+void bench_hrtimer(void);
+
+/* Cost of one flight recorder record (trace.h) */
+void bench_trace(void);
+
+/* xQueueSend/xQueueReceive copies vs loaned-buffer messages at several sizes (msg.h) */
+void bench_msg(void);
+
+#endif /* BENCH_H */
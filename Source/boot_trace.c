@@ -0,0 +1,49 @@
+/*
+ * Boot-phase timestamps and breadcrumbs for RPi2 BCM2837
+ */
+
+#include "boot_trace.h"
+#include "cpu.h"
+#include "uart.h"
+#include "placement.h"
+
+static const char * const boot_phase_names[BOOT_PHASE_COUNT] = {
+    "entry", "svc", "bss-cleared", "main", "scheduler", "first-task"
+};
+
+void boot_trace_mark(unsigned int phase) {
+    if (phase < BOOT_PHASE_COUNT) {
+        boot_stamps[phase] = cpu_cntpct();
+    }
+}
+
+/* CNTPCT ticks (19.2 MHz) to microseconds */
+static uint32_t boot_ticks_to_us(uint64_t ticks) {
+    return (uint32_t)((ticks * 10) / (CPU_CNTPCT_HZ / 100000));
+}
+
+COLD_FUNC void boot_trace_report(void) {
+    uint64_t prev = boot_stamps[BOOT_PHASE_ENTRY];
+
+    uart_puts("=== BOOT TIMELINE (us) ===\r\n");
+    for (unsigned int i = 0; i < BOOT_PHASE_COUNT; i++) {
+        uint64_t stamp = boot_stamps[i];
+        if (stamp == 0) {
+            uart_printf("  %s: not reached\n", boot_phase_names[i]);
+            continue;
+        }
+        uart_printf("  %s: %u since power-on, +%u\n", boot_phase_names[i],
+                    boot_ticks_to_us(stamp), boot_ticks_to_us(stamp - prev));
+        prev = stamp;
+    }
+    uart_printf("  time-to-first-task: %u\n",
+                boot_ticks_to_us(boot_stamps[BOOT_PHASE_FIRST_TASK] - boot_stamps[BOOT_PHASE_ENTRY]));
+
+    if (boot_mark_count > 0) {
+        uart_puts("Boot breadcrumbs: ");
+        for (uint32_t i = 0; i < boot_mark_count && i < BOOT_MARKS_MAX; i++) {
+            uart_putc(boot_marks[i]);
+        }
+        uart_puts("\r\n");
+    }
+}
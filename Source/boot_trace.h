@@ -0,0 +1,47 @@
+/*
+ * Boot-phase timestamps and breadcrumbs for RPi2 BCM2837
+ *
+ * startup_rpi2.S stamps CNTPCT into boot_stamps[] at each phase before
+ * main(); C code stamps the remaining phases. The array lives in .data so
+ * the BSS clear does not wipe the early entries. CNTPCT counts from
+ * power-on, so BOOT_PHASE_ENTRY is also the GPU firmware hand-off time.
+ *
+ * In FAST_BOOT builds the startup breadcrumbs (X, Y, I, ...) are written
+ * to boot_marks[] in RAM instead of the UART.
+ *
+ * Shared with startup_rpi2.S - keep C declarations under __ASSEMBLER__.
+ */
+
+#ifndef BOOT_TRACE_H
+#define BOOT_TRACE_H
+
+/* Boot phases (index into boot_stamps[]) */
+#define BOOT_PHASE_ENTRY        0   /* _start, CPU0 only */
+#define BOOT_PHASE_SVC          1   /* HYP exit done, running in SVC */
+#define BOOT_PHASE_BSS_CLEARED  2   /* .bss zeroed */
+#define BOOT_PHASE_MAIN         3   /* About to call main() */
+#define BOOT_PHASE_SCHEDULER    4   /* vTaskStartScheduler() called */
+#define BOOT_PHASE_FIRST_TASK   5   /* First task (timer daemon) running */
+#define BOOT_PHASE_COUNT        6
+
+/* Breadcrumb buffer size for FAST_BOOT builds */
+#define BOOT_MARKS_MAX          32
+
+#ifndef __ASSEMBLER__
+
+#include <stdint.h>
+
+/* Defined in startup_rpi2.S (.data) */
+extern volatile uint64_t boot_stamps[BOOT_PHASE_COUNT];
+extern volatile uint32_t boot_mark_count;
+extern volatile char boot_marks[BOOT_MARKS_MAX];
+
+/* Record CNTPCT for a phase */
+void boot_trace_mark(unsigned int phase);
+
+/* Print every phase as time since power-on and since the previous phase */
+void boot_trace_report(void);
+
+#endif /* __ASSEMBLER__ */
+
+#endif /* BOOT_TRACE_H */
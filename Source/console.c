@@ -0,0 +1,112 @@
+/*
+ * UART0 Console for RPi2 BCM2837
+ * Interrupt-driven receive ring and yielding transmit on the PL011
+ */
+
+#include "console.h"
+#include "uart.h"
+#include "bcm2837_irq.h"
+#include "placement.h"
+#include <stdarg.h>
+
+/* Single-producer (IRQ_UART) / single-consumer (reader task) ring */
+static struct {
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile uint32_t overflows;
+    TaskHandle_t reader;
+    char data[CONSOLE_RX_SIZE];
+} console_rx ISR_DATA;
+
+/* ========== Receive ========== */
+
+static void console_rx_store(char c) {
+    uint32_t head = console_rx.head;
+    if (head - console_rx.tail >= CONSOLE_RX_SIZE) {
+        console_rx.overflows++;
+        return;
+    }
+    console_rx.data[head & (CONSOLE_RX_SIZE - 1)] = c;
+    console_rx.head = head + 1;
+}
+
+HOT_FUNC static void console_rx_handler(void *context) {
+    BaseType_t woken = pdFALSE;
+    char c;
+    (void)context;
+
+    while (uart_try_getc(&c)) {
+        console_rx_store(c);
+    }
+    uart_rx_irq_ack();
+
+    if (console_rx.head != console_rx.tail && console_rx.reader) {
+        vTaskNotifyGiveIndexedFromISR(console_rx.reader, configCONSOLE_NOTIFY_INDEX, &woken);
+    }
+    portYIELD_FROM_ISR(woken);
+}
+
+COLD_FUNC void console_init(TaskHandle_t reader) {
+    console_rx.reader = reader;
+    bcm2837_irq_register(IRQ_UART, console_rx_handler, NULL);
+    uart_rx_irq_enable(1);
+    bcm2837_enable_vc_irq(IRQ_UART);
+}
+
+int console_getc(char *c) {
+    uint32_t tail = console_rx.tail;
+
+#ifdef HOST_SIM
+    /* No receive interrupt - refill from stdin here */
+    char in;
+    while (uart_try_getc(&in)) {
+        console_rx_store(in);
+    }
+#endif
+
+    if (tail == console_rx.head) {
+        return 0;
+    }
+    *c = console_rx.data[tail & (CONSOLE_RX_SIZE - 1)];
+    console_rx.tail = tail + 1;
+    return 1;
+}
+
+void console_wait(void) {
+    if (console_rx.head == console_rx.tail) {
+        ulTaskNotifyTakeIndexed(configCONSOLE_NOTIFY_INDEX, pdTRUE, CONSOLE_RX_WAIT);
+    }
+}
+
+uint32_t console_rx_overflows(void) {
+    return console_rx.overflows;
+}
+
+/* ========== Transmit ========== */
+
+static void console_put_raw(char c) {
+    while (!uart_try_putc(c)) {
+        vTaskDelay(1);
+    }
+}
+
+void console_putc(char c) {
+    if (c == '\n') {
+        console_put_raw('\r');
+    }
+    console_put_raw(c);
+}
+
+void console_puts(const char *s) {
+    while (*s) {
+        console_putc(*s++);
+    }
+}
+
+int console_printf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    uart_vprintf(console_putc, format, args);
+    va_end(args);
+    return 0;
+}
@@ -0,0 +1,55 @@
+/*
+ * UART0 Console for RPi2 BCM2837
+ *
+ * Non-blocking I/O for low-priority interactive code (the diagnostics
+ * shell, shell.h) sharing UART0 with the real-time tasks:
+ *
+ * - Receive is interrupt driven. The IRQ_UART handler drains the RX FIFO
+ *   into a ring and notifies the reader task on configCONSOLE_NOTIFY_INDEX,
+ *   so the reader blocks instead of polling.
+ * - Transmit never spins: console_putc() hands one byte to the FIFO when
+ *   there is room and otherwise sleeps a tick, so a long report costs the
+ *   writer's own time only. Other tasks' uart_putc() waits at most one
+ *   FIFO's worth (16 bytes) behind console output.
+ *
+ * Only one reader task. HOST_SIM has no receive interrupt; the reader
+ * polls stdin every CONSOLE_RX_WAIT instead.
+ */
+
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Received bytes buffered ahead of the reader - power of two */
+#define CONSOLE_RX_SIZE         128
+
+/* Longest a reader waits in console_wait() */
+#ifndef HOST_SIM
+#define CONSOLE_RX_WAIT         portMAX_DELAY
+#else
+#define CONSOLE_RX_WAIT         pdMS_TO_TICKS(20)
+#endif
+
+/* Start receiving for reader (normally the calling task) - call once, from a task */
+void console_init(TaskHandle_t reader);
+
+/* Take one received byte - returns 0 if none is waiting, never blocks */
+int console_getc(char *c);
+
+/* Block the reader until console_getc() may have data */
+void console_wait(void);
+
+/* Write one byte ('\n' becomes "\r\n"), sleeping while the TX FIFO is full */
+void console_putc(char c);
+void console_puts(const char *s);
+
+/* uart_printf() formatting through console_putc() */
+int console_printf(const char *format, ...);
+
+/* Bytes dropped because the ring was full */
+uint32_t console_rx_overflows(void);
+
+#endif /* CONSOLE_H */
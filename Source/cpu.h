@@ -0,0 +1,136 @@
+/*
+ * Cortex-A53 (AArch32) CPU helpers for RPi2 BCM2837
+ * Interrupt masking and cycle/counter access
+ *
+ * HOST_SIM builds (build_host.sh) get POSIX stand-ins with the same
+ * contracts: the IRQ mask is the SIGALRM mask the POSIX port ticks on,
+ * and both counters are derived from CLOCK_MONOTONIC.
+ */
+
+#ifndef CPU_H
+#define CPU_H
+
+#include <stdint.h>
+
+/* ARM generic timer (CNTPCT) frequency - 19.2 MHz crystal on BCM2837 */
+#define CPU_CNTPCT_HZ   19200000u
+
+#ifndef HOST_SIM
+
+/* ========== Interrupt Masking ========== */
+
+/*
+ * Mask IRQs on this core and return the previous CPSR.
+ * FIQ is left enabled so the FIQ fast path keeps its latency.
+ */
+static inline uint32_t cpu_irq_save(void) {
+    uint32_t cpsr;
+    __asm volatile("mrs %0, cpsr\n\tcpsid i" : "=r" (cpsr) :: "memory");
+    return cpsr;
+}
+
+/* Restore the IRQ mask saved by cpu_irq_save() */
+static inline void cpu_irq_restore(uint32_t cpsr) {
+    __asm volatile("msr cpsr_c, %0" :: "r" (cpsr) : "memory");
+}
+
+/*
+ * Sleep until an interrupt is pending - call with IRQs masked
+ * (cpu_irq_save) so a wakeup between the caller's checks and the wfi is
+ * not lost. The interrupt is taken after cpu_irq_restore().
+ */
+static inline void cpu_wait_for_interrupt(void) {
+    __asm volatile("dsb\n\twfi" ::: "memory");
+}
+
+/* ========== Counters ========== */
+
+/*
+ * Enable the PMU cycle counter (PMCCNTR).
+ * PMCR.E enables the counters, PMCR.C resets the cycle counter,
+ * PMCNTENSET bit 31 enables the cycle counter itself.
+ */
+static inline void cpu_cycles_init(void) {
+    uint32_t pmcr;
+    __asm volatile("mrc p15, 0, %0, c9, c12, 0" : "=r" (pmcr));
+    pmcr |= (1 << 0) | (1 << 2);
+    __asm volatile("mcr p15, 0, %0, c9, c12, 0" :: "r" (pmcr));
+    __asm volatile("mcr p15, 0, %0, c9, c12, 1" :: "r" (1u << 31));
+}
+
+/* Read the PMU cycle counter (CPU clock, wraps every ~4.7s at 900 MHz) */
+static inline uint32_t cpu_cycles(void) {
+    uint32_t cycles;
+    __asm volatile("mrc p15, 0, %0, c9, c13, 0" : "=r" (cycles) :: "memory");
+    return cycles;
+}
+
+/* Read the 64-bit ARM generic timer physical count (CNTPCT) */
+static inline uint64_t cpu_cntpct(void) {
+    uint32_t lo, hi;
+    __asm volatile("isb\n\tmrrc p15, 0, %0, %1, c14" : "=r" (lo), "=r" (hi) :: "memory");
+    return ((uint64_t)hi << 32) | lo;
+}
+
+#else /* HOST_SIM */
+
+#include <signal.h>
+#include <time.h>
+
+/* ========== Interrupt Masking ========== */
+
+/* Block the tick signal so the POSIX port cannot preempt; returns 1 if it was already blocked */
+static inline uint32_t cpu_irq_save(void) {
+    sigset_t tick, old;
+    sigemptyset(&tick);
+    sigaddset(&tick, SIGALRM);
+    pthread_sigmask(SIG_BLOCK, &tick, &old);
+    return (uint32_t)sigismember(&old, SIGALRM);
+}
+
+static inline void cpu_irq_restore(uint32_t was_blocked) {
+    if (!was_blocked) {
+        sigset_t tick;
+        sigemptyset(&tick);
+        sigaddset(&tick, SIGALRM);
+        pthread_sigmask(SIG_UNBLOCK, &tick, NULL);
+    }
+}
+
+/* Unblock the tick and sleep until a signal arrives, atomically - the host wfi */
+static inline void cpu_wait_for_interrupt(void) {
+    sigset_t wake;
+    pthread_sigmask(SIG_BLOCK, NULL, &wake);
+    sigdelset(&wake, SIGALRM);
+    sigsuspend(&wake);
+}
+
+/* ========== Counters ========== */
+
+static inline uint64_t cpu_host_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static inline void cpu_cycles_init(void) {
+}
+
+/* Nanoseconds - no cycle counter is readable from user space */
+static inline uint32_t cpu_cycles(void) {
+    return (uint32_t)cpu_host_ns();
+}
+
+/* CLOCK_MONOTONIC scaled to CNTPCT ticks (19.2 MHz = 24 per 1250 ns) so the conversions still hold */
+static inline uint64_t cpu_cntpct(void) {
+    return cpu_host_ns() * 24 / 1250;
+}
+
+#endif /* HOST_SIM */
+
+/* Convert a CNTPCT interval to microseconds */
+static inline uint32_t cpu_cntpct_to_us(uint32_t ticks) {
+    return (uint32_t)(((uint64_t)ticks * 10) / (CPU_CNTPCT_HZ / 100000));
+}
+
+#endif /* CPU_H */
@@ -0,0 +1,352 @@
+/*
+ * DMA Controller Driver for RPi2 BCM2837
+ * Channel allocation, control block start/abort, completion interrupts
+ * and the memory copy/fill service
+ */
+
+#include "dma.h"
+#include "bcm2837_irq.h"
+#include "cpu.h"
+#include "mmio.h"
+#include "placement.h"
+#include <stddef.h>
+
+/* DMA registers - channel n at DMA_BASE + n * 0x100 */
+#define DMA_BASE                0x3F007000
+#define DMA_ENABLE              (DMA_BASE + 0xFF0)
+
+/* Channel registers - pass to mmio_read()/mmio_write() */
+#define DMA_CS(ch)              (DMA_BASE + (ch) * 0x100 + 0x00)
+#define DMA_CONBLK_AD(ch)       (DMA_BASE + (ch) * 0x100 + 0x04)
+#define DMA_DEBUG(ch)           (DMA_BASE + (ch) * 0x100 + 0x20)
+
+/* CS bits */
+#define DMA_CS_ACTIVE           (1u << 0)
+#define DMA_CS_END              (1u << 1)   /* Write 1 to clear */
+#define DMA_CS_INT              (1u << 2)   /* Write 1 to clear */
+#define DMA_CS_ERROR            (1u << 8)
+#define DMA_CS_PRIORITY(n)      (((n) & 0xF) << 16)
+#define DMA_CS_PANIC_PRIORITY(n) (((n) & 0xF) << 20)
+#define DMA_CS_WAIT_WRITES      (1u << 28)  /* Wait for outstanding writes before END */
+#define DMA_CS_ABORT            (1u << 30)
+#define DMA_CS_RESET            (1u << 31)
+
+/* DEBUG error bits - write 1 to clear */
+#define DMA_DEBUG_ERRORS        0x7
+
+typedef struct {
+    dma_callback_t done;
+    void *context;
+} dma_channel_t;
+
+static dma_channel_t dma_channels[DMA_NUM_CHANNELS];
+static uint32_t dma_allocated;
+
+/* Memory service queue: dma_op_head is running on dma_service_channel */
+static int dma_service_channel = -1;
+static dma_op_t *dma_op_head;
+static dma_op_t *dma_op_tail;
+
+/* ========== Completion Interrupt ========== */
+
+HOT_FUNC static void dma_channel_irq(void *context) {
+    int ch = (int)context;
+    uint32_t cs = mmio_read(DMA_CS(ch));
+    int error = (cs & DMA_CS_ERROR) != 0;
+
+    /* Keep ACTIVE set so a chain that continues past this CB is not paused */
+    mmio_write(DMA_CS(ch), DMA_CS_INT | DMA_CS_END | (cs & DMA_CS_ACTIVE));
+    if (error) {
+        mmio_write(DMA_DEBUG(ch), DMA_DEBUG_ERRORS);
+    }
+
+    if (dma_channels[ch].done) {
+        dma_channels[ch].done(ch, error, dma_channels[ch].context);
+    }
+}
+
+COLD_FUNC void dma_init(void) {
+    for (int ch = 0; ch < DMA_NUM_CHANNELS; ch++) {
+        if (!(DMA_CHANNEL_MASK & (1u << ch))) {
+            continue;
+        }
+        mmio_modify(DMA_ENABLE, 0, 1u << ch);
+        mmio_write(DMA_CS(ch), DMA_CS_RESET);
+        bcm2837_irq_register(IRQ_DMA_0 + ch, dma_channel_irq, (void *)ch);
+        bcm2837_enable_vc_irq(IRQ_DMA_0 + ch);
+    }
+
+    dma_service_channel = dma_channel_alloc(DMA_CHAN_FULL);
+}
+
+/* ========== Channel Allocation ========== */
+
+int dma_channel_alloc(uint32_t flags) {
+    int found = -1;
+
+    uint32_t cpsr = cpu_irq_save();
+    for (int ch = 0; ch < DMA_NUM_CHANNELS; ch++) {
+        uint32_t bit = 1u << ch;
+        if (!(DMA_CHANNEL_MASK & bit) || (dma_allocated & bit)) {
+            continue;
+        }
+        if ((flags & DMA_CHAN_FULL) && DMA_IS_LITE(ch)) {
+            continue;
+        }
+        /* Keep looking for a lite channel, but remember the first fallback */
+        if (found < 0) {
+            found = ch;
+        }
+        if (!(flags & DMA_CHAN_LITE) || DMA_IS_LITE(ch)) {
+            found = ch;
+            break;
+        }
+    }
+    if (found >= 0) {
+        dma_allocated |= 1u << found;
+    }
+    cpu_irq_restore(cpsr);
+
+    return found;
+}
+
+void dma_channel_free(int channel) {
+    if (channel < 0 || channel >= DMA_NUM_CHANNELS) {
+        return;
+    }
+    dma_abort(channel);
+
+    uint32_t cpsr = cpu_irq_save();
+    dma_allocated &= ~(1u << channel);
+    cpu_irq_restore(cpsr);
+}
+
+/* ========== Transfers ========== */
+
+void dma_start(int channel, const dma_cb_t *cb, dma_callback_t done, void *context) {
+    configASSERT(dma_bus_addr(cb) != 0);
+
+    dma_channels[channel].done = done;
+    dma_channels[channel].context = context;
+
+    /* Control blocks and buffers must reach memory before the engine reads them */
+    mmio_dsb();
+
+    mmio_write(DMA_CS(channel), DMA_CS_INT | DMA_CS_END);
+    mmio_write(DMA_CONBLK_AD(channel), dma_bus_addr(cb));
+    mmio_write(DMA_CS(channel), DMA_CS_ACTIVE | DMA_CS_WAIT_WRITES |
+               DMA_CS_PRIORITY(8) | DMA_CS_PANIC_PRIORITY(15));
+}
+
+int dma_busy(int channel) {
+    return (mmio_read(DMA_CS(channel)) & DMA_CS_ACTIVE) != 0;
+}
+
+void dma_abort(int channel) {
+    dma_channels[channel].done = NULL;
+
+    /* Pause, abort the current CB, then reset the channel */
+    mmio_write(DMA_CS(channel), 0);
+    mmio_write(DMA_CS(channel), DMA_CS_ABORT);
+    mmio_write(DMA_CS(channel), DMA_CS_RESET);
+    mmio_write(DMA_DEBUG(channel), DMA_DEBUG_ERRORS);
+}
+
+/* ========== Memory Service ========== */
+
+static inline uint32_t dma_stamp(void) {
+    return (uint32_t)cpu_cntpct();
+}
+
+static void dma_op_done(int channel, int error, void *context);
+
+/* Start op on the service channel - IRQs masked */
+static void dma_op_start(dma_op_t *op) {
+    dma_start(dma_service_channel, op->chain ? op->chain : &op->cb, dma_op_done, NULL);
+}
+
+/* Completion of the last CB of dma_op_head - IRQ context */
+HOT_FUNC static void dma_op_done(int channel, int error, void *context) {
+    BaseType_t woken = pdFALSE;
+    dma_op_t *op = dma_op_head;
+
+    (void)channel;
+    (void)context;
+
+    if (op == NULL) {
+        return;
+    }
+
+    /* A chain may raise INTEN on intermediate CBs - wait for the end */
+    if (!error && dma_busy(dma_service_channel)) {
+        return;
+    }
+
+    dma_op_head = op->queue_next;
+    if (dma_op_head == NULL) {
+        dma_op_tail = NULL;
+    }
+
+    op->t_done = dma_stamp();
+    op->status = error ? DMA_OP_ERROR : DMA_OP_OK;
+    if (op->done) {
+        op->done(op);
+    }
+    if (op->notify) {
+        vTaskNotifyGiveIndexedFromISR(op->notify, configDRIVER_NOTIFY_INDEX, &woken);
+    }
+
+    if (dma_op_head) {
+        dma_op_start(dma_op_head);
+    }
+    portYIELD_FROM_ISR(woken);
+}
+
+static int dma_op_queue(dma_op_t *op) {
+    if (dma_service_channel < 0) {
+        op->status = DMA_OP_INVALID;
+        return DMA_OP_INVALID;
+    }
+
+    op->status = DMA_OP_PENDING;
+    op->t_submit = dma_stamp();
+    op->queue_next = NULL;
+
+    uint32_t cpsr = cpu_irq_save();
+    if (dma_op_tail) {
+        dma_op_tail->queue_next = op;
+        dma_op_tail = op;
+    } else {
+        dma_op_head = op;
+        dma_op_tail = op;
+        dma_op_start(op);
+    }
+    cpu_irq_restore(cpsr);
+
+    return DMA_OP_PENDING;
+}
+
+int dma_submit(dma_op_t *op) {
+    if (op->chain == NULL || dma_bus_addr(op->chain) == 0) {
+        op->status = DMA_OP_INVALID;
+        return DMA_OP_INVALID;
+    }
+    return dma_op_queue(op);
+}
+
+/* 128-bit accesses when every address and the length are 16-byte multiples */
+static uint32_t dma_width_bits(uint32_t a, uint32_t b, uint32_t len) {
+    return ((a | b | len) & 15) ? 0 : (DMA_TI_SRC_WIDTH | DMA_TI_DEST_WIDTH);
+}
+
+static int dma_op_invalid(dma_op_t *op) {
+    op->status = DMA_OP_INVALID;
+    return DMA_OP_INVALID;
+}
+
+int dma_memcpy_async(dma_op_t *op, void *dst, const void *src, size_t len) {
+    if (len == 0 || (((uint32_t)dst | (uint32_t)src | len) & 3) ||
+        !dma_ram_range(dst, len) || !dma_ram_range(src, len)) {
+        return dma_op_invalid(op);
+    }
+
+    op->chain = NULL;
+    op->cb.ti = DMA_TI_SRC_INC | DMA_TI_DEST_INC | DMA_TI_WAIT_RESP | DMA_TI_INTEN |
+                DMA_TI_BURST(4) | dma_width_bits((uint32_t)dst, (uint32_t)src, len);
+    op->cb.source_ad = dma_bus_addr(src);
+    op->cb.dest_ad = dma_bus_addr(dst);
+    op->cb.txfr_len = len;
+    op->cb.stride = 0;
+    op->cb.nextconbk = 0;
+    return dma_op_queue(op);
+}
+
+int dma_fill32_async(dma_op_t *op, void *dst, uint32_t pattern, size_t len) {
+    if (len == 0 || (((uint32_t)dst | len) & 3) ||
+        !dma_ram_range(dst, len) || !dma_ram_range(op->fill, sizeof(op->fill))) {
+        return dma_op_invalid(op);
+    }
+
+    /* Fill mode: the source does not increment and keeps re-reading op->fill */
+    for (int i = 0; i < 4; i++) {
+        op->fill[i] = pattern;
+    }
+    op->chain = NULL;
+    op->cb.ti = DMA_TI_DEST_INC | DMA_TI_WAIT_RESP | DMA_TI_INTEN |
+                DMA_TI_BURST(4) | dma_width_bits((uint32_t)dst, 0, len);
+    op->cb.source_ad = dma_bus_addr(op->fill);
+    op->cb.dest_ad = dma_bus_addr(dst);
+    op->cb.txfr_len = len;
+    op->cb.stride = 0;
+    op->cb.nextconbk = 0;
+    return dma_op_queue(op);
+}
+
+int dma_memset_async(dma_op_t *op, void *dst, uint8_t value, size_t len) {
+    return dma_fill32_async(op, dst, value * 0x01010101u, len);
+}
+
+int dma_copy2d_async(dma_op_t *op, void *dst, uint32_t dst_pitch,
+                     const void *src, uint32_t src_pitch, uint32_t width, uint32_t rows) {
+    int32_t src_stride = (int32_t)(src_pitch - width);
+    int32_t dst_stride = (int32_t)(dst_pitch - width);
+
+    if (width == 0 || width > 0xFFFF || rows == 0 || rows > 0x4000 ||
+        src_stride < -32768 || src_stride > 32767 || dst_stride < -32768 || dst_stride > 32767 ||
+        (((uint32_t)dst | (uint32_t)src | width | src_pitch | dst_pitch) & 3)) {
+        return dma_op_invalid(op);
+    }
+    /* Last row ends (rows - 1) pitches after the first starts */
+    if (!dma_ram_range(dst, (rows - 1) * dst_pitch + width) ||
+        !dma_ram_range(src, (rows - 1) * src_pitch + width)) {
+        return dma_op_invalid(op);
+    }
+
+    op->chain = NULL;
+    op->cb.ti = DMA_TI_TDMODE | DMA_TI_SRC_INC | DMA_TI_DEST_INC | DMA_TI_WAIT_RESP |
+                DMA_TI_INTEN | DMA_TI_BURST(4);
+    op->cb.source_ad = dma_bus_addr(src);
+    op->cb.dest_ad = dma_bus_addr(dst);
+    op->cb.txfr_len = DMA_TXFR_2D(width, rows);
+    op->cb.stride = DMA_STRIDE(src_stride, dst_stride);
+    op->cb.nextconbk = 0;
+    return dma_op_queue(op);
+}
+
+/* ========== Blocking Forms ========== */
+
+static int dma_op_wait(dma_op_t *op, int queued) {
+    if (queued != DMA_OP_PENDING) {
+        return queued;
+    }
+    if (ulTaskNotifyTakeIndexed(configDRIVER_NOTIFY_INDEX, pdTRUE, portMAX_DELAY) == 0) {
+        return DMA_OP_TIMEOUT;
+    }
+    return op->status;
+}
+
+/* Blocking ops live on the caller's stack - notify must be set before queueing */
+static void dma_op_prepare(dma_op_t *op) {
+    op->done = NULL;
+    op->context = NULL;
+    op->notify = xTaskGetCurrentTaskHandle();
+    ulTaskNotifyTakeIndexed(configDRIVER_NOTIFY_INDEX, pdTRUE, 0);    /* Drop a stale give */
+}
+
+int dma_memcpy(void *dst, const void *src, size_t len) {
+    dma_op_t op;
+    dma_op_prepare(&op);
+    return dma_op_wait(&op, dma_memcpy_async(&op, dst, src, len));
+}
+
+int dma_memset(void *dst, uint8_t value, size_t len) {
+    dma_op_t op;
+    dma_op_prepare(&op);
+    return dma_op_wait(&op, dma_memset_async(&op, dst, value, len));
+}
+
+int dma_fill32(void *dst, uint32_t pattern, size_t len) {
+    dma_op_t op;
+    dma_op_prepare(&op);
+    return dma_op_wait(&op, dma_fill32_async(&op, dst, pattern, len));
+}
@@ -0,0 +1,199 @@
+/*
+ * DMA Controller Driver for RPi2 BCM2837
+ *
+ * Channels 0-14 at 0x3F007000 (0x100 apart). A transfer is described by
+ * a chain of 32-byte aligned control blocks in RAM; the engine follows
+ * NEXTCONBK until it reaches 0. Completion of a control block with
+ * DMA_TI_INTEN raises VideoCore IRQ 16 + channel, which calls the
+ * callback given to dma_start() in IRQ context.
+ *
+ * The DMA engine sees bus addresses, not ARM physical addresses - use
+ * dma_bus_addr() for RAM and DMA_PERIPH_BUS() for peripheral registers.
+ * Only the image's own SDRAM (the RAM region of link_rpi2.ld) is accepted:
+ * the bus alias keeps the low 30 bits of any address, so anything else
+ * would silently land on unrelated RAM.
+ *
+ * On top of the raw channels sits a memory service: dma_init() claims one
+ * full channel, and dma_op_t requests (copy, fill, 2D copy or a caller-built
+ * control block chain) queue on it and run back to back from the completion
+ * interrupt. Completion is reported through an IRQ callback and/or a task
+ * notification, so the CPU is free while megabytes are moved or painted.
+ * Caches are off in this tree, so no cache maintenance is done - turning
+ * the D-cache on needs it added first (see mmu.h).
+ */
+
+#ifndef DMA_H
+#define DMA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "FreeRTOS.h"
+#include "task.h"
+
+/*
+ * Channels the ARM may use. The GPU firmware owns the others, and 11-14
+ * share one interrupt line, so they are left out as well.
+ */
+#define DMA_CHANNEL_MASK        0x0734  /* 2, 4, 5 (full), 8, 9, 10 (lite) */
+#define DMA_NUM_CHANNELS        15
+
+/* Channels 0-6 are full channels (2D mode, 30-bit length); 7-14 are "lite" */
+#define DMA_IS_LITE(ch)         ((ch) >= 7)
+#define DMA_LITE_MAX_LEN        65535
+
+/* Control block transfer information (TI) bits */
+#define DMA_TI_INTEN            (1 << 0)    /* Interrupt on completion of this CB */
+#define DMA_TI_TDMODE           (1 << 1)    /* 2D mode: TXFR_LEN = YLENGTH:XLENGTH */
+#define DMA_TI_WAIT_RESP        (1 << 3)    /* Wait for write response */
+#define DMA_TI_DEST_INC         (1 << 4)
+#define DMA_TI_DEST_WIDTH       (1 << 5)    /* 128-bit destination writes */
+#define DMA_TI_DEST_DREQ        (1 << 6)    /* Pace writes by PERMAP DREQ */
+#define DMA_TI_DEST_IGNORE      (1 << 7)    /* Do not write (discard) */
+#define DMA_TI_SRC_INC          (1 << 8)
+#define DMA_TI_SRC_WIDTH        (1 << 9)    /* 128-bit source reads */
+#define DMA_TI_SRC_DREQ         (1 << 10)   /* Pace reads by PERMAP DREQ */
+#define DMA_TI_SRC_IGNORE       (1 << 11)   /* Do not read (write zeros) */
+#define DMA_TI_BURST(n)         (((n) & 0xF) << 12)
+#define DMA_TI_PERMAP(n)        (((n) & 0x1F) << 16)
+#define DMA_TI_NO_WIDE_BURSTS   (1 << 26)
+
+/* dma_channel_alloc() flags */
+#define DMA_CHAN_ANY            0
+#define DMA_CHAN_FULL           (1 << 0)    /* Need 2D mode or transfers over 64 KB */
+#define DMA_CHAN_LITE           (1 << 1)    /* Prefer a lite channel, fall back to any */
+
+/* Peripheral DREQ numbers for DMA_TI_PERMAP */
+#define DMA_DREQ_SPI_TX         6
+#define DMA_DREQ_SPI_RX         7
+
+/* 2D mode TXFR_LEN and STRIDE encoding (full channels only) */
+#define DMA_TXFR_2D(xlen, ylen) ((((uint32_t)(ylen) - 1) << 16) | ((xlen) & 0xFFFF))
+#define DMA_STRIDE(src, dst)    ((((uint32_t)(dst) & 0xFFFF) << 16) | ((uint32_t)(src) & 0xFFFF))
+
+/* Control block - must be 32-byte aligned */
+typedef struct {
+    uint32_t ti;
+    uint32_t source_ad;
+    uint32_t dest_ad;
+    uint32_t txfr_len;
+    uint32_t stride;
+    uint32_t nextconbk;
+    uint32_t reserved[2];
+} __attribute__((aligned(32))) dma_cb_t;
+
+/* Completion callback - IRQ context; error is non-zero if the channel faulted */
+typedef void (*dma_callback_t)(int channel, int error, void *context);
+
+/* Peripheral physical address (0x3Fxxxxxx) to bus address (0x7Exxxxxx) */
+#define DMA_PERIPH_BUS(addr)    (((uint32_t)(addr) & 0x00FFFFFF) | 0x7E000000)
+
+/* SDRAM the image is linked into - provided by link_rpi2.ld */
+extern uint8_t __ram_start__[];
+extern uint8_t __ram_end__[];
+
+/* 1 if [p, p + len) lies inside the linked SDRAM */
+static inline int dma_ram_range(const volatile void *p, size_t len) {
+    uintptr_t a = (uintptr_t)p;
+    return a >= (uintptr_t)__ram_start__ && a <= (uintptr_t)__ram_end__ &&
+           len <= (uintptr_t)__ram_end__ - a;
+}
+
+/*
+ * RAM address to bus address through the uncached (L2-bypassing) alias,
+ * or 0 if p is outside the linked SDRAM (every valid result has the
+ * 0xC0000000 alias bits set, so 0 is never a real bus address)
+ */
+static inline uint32_t dma_bus_addr(const volatile void *p) {
+    if (!dma_ram_range(p, 1)) {
+        return 0;
+    }
+    return (uint32_t)(uintptr_t)p | 0xC0000000;
+}
+
+/* Enable the controller, register the channel IRQ handlers and claim the service channel */
+void dma_init(void);
+
+/* Claim a channel from DMA_CHANNEL_MASK (DMA_CHAN_* flags). -1 if none */
+int dma_channel_alloc(uint32_t flags);
+void dma_channel_free(int channel);
+
+/* Reset the channel and start the control block chain at cb (in linked SDRAM) */
+void dma_start(int channel, const dma_cb_t *cb, dma_callback_t done, void *context);
+
+/* 1 while the channel is transferring */
+int dma_busy(int channel);
+
+/* Abort the current chain (no callback) and reset the channel */
+void dma_abort(int channel);
+
+/* Point cb at next (NULL ends the chain) */
+static inline void dma_cb_link(dma_cb_t *cb, const dma_cb_t *next) {
+    cb->nextconbk = next ? dma_bus_addr(next) : 0;
+}
+
+/* ========== Memory Service ========== */
+
+/* dma_op_t.status */
+#define DMA_OP_OK               0
+#define DMA_OP_PENDING          1
+#define DMA_OP_ERROR            (-1)        /* Channel fault (bad bus address) */
+#define DMA_OP_INVALID          (-2)        /* Bad alignment/length or no service channel */
+#define DMA_OP_TIMEOUT          (-3)        /* Blocking call gave up waiting */
+
+typedef struct dma_op dma_op_t;
+
+/* Completion callback - IRQ context */
+typedef void (*dma_op_callback_t)(dma_op_t *op);
+
+/*
+ * One request on the service channel. Fill in done/context/notify, then
+ * pass it to one of the *_async() calls; it must stay valid until status
+ * leaves DMA_OP_PENDING.
+ */
+struct dma_op {
+    dma_cb_t cb;                    /* Built by the *_async() helpers */
+    uint32_t fill[4] __attribute__((aligned(16)));  /* Fill pattern for 128-bit source reads */
+    const dma_cb_t *chain;          /* dma_submit(): caller-built chain run instead of cb */
+
+    dma_op_callback_t done;         /* Optional, called from the DMA IRQ */
+    void *context;
+    TaskHandle_t notify;            /* Optional, notified on configDRIVER_NOTIFY_INDEX */
+
+    volatile int32_t status;
+    uint32_t t_submit;              /* CNTPCT low words */
+    uint32_t t_done;
+
+    dma_op_t *queue_next;           /* Driver private */
+};
+
+/*
+ * Asynchronous requests. dst, src and len must be multiples of 4; when
+ * all are multiples of 16 the engine uses 128-bit reads and writes.
+ * Buffers must lie inside the linked SDRAM (dma_ram_range()). Return
+ * DMA_OP_PENDING once queued, or DMA_OP_INVALID.
+ */
+int dma_memcpy_async(dma_op_t *op, void *dst, const void *src, size_t len);
+int dma_memset_async(dma_op_t *op, void *dst, uint8_t value, size_t len);
+int dma_fill32_async(dma_op_t *op, void *dst, uint32_t pattern, size_t len);
+
+/*
+ * Copy a rows x width byte rectangle between buffers with row pitches
+ * src_pitch and dst_pitch (2D mode: width <= 65535, rows <= 16384,
+ * pitch - width must fit in 16 bits signed).
+ */
+int dma_copy2d_async(dma_op_t *op, void *dst, uint32_t dst_pitch,
+                     const void *src, uint32_t src_pitch, uint32_t width, uint32_t rows);
+
+/*
+ * Queue a caller-built control block chain (linked with dma_cb_link()).
+ * op->chain must be set and the last CB must have DMA_TI_INTEN. Earlier
+ * CBs may set it too; the op only completes once the chain has ended.
+ */
+int dma_submit(dma_op_t *op);
+
+/* Blocking forms - wait on configDRIVER_NOTIFY_INDEX, call from a task */
+int dma_memcpy(void *dst, const void *src, size_t len);
+int dma_memset(void *dst, uint8_t value, size_t len);
+int dma_fill32(void *dst, uint32_t pattern, size_t len);
+
+#endif /* DMA_H */
@@ -0,0 +1,166 @@
+/*
+ * FIQ fast path for RPi2 BCM2837
+ * Source routing, FIQ-to-task ring and the system timer latency source
+ */
+
+#include "fiq.h"
+#include "bcm2837_irq.h"
+#include "bcm2837_systimer.h"
+#include "cpu.h"
+#include "placement.h"
+#include <stddef.h>
+
+/* IRQ_FIQ_CONTROL: bits 0-6 select the source, bit 7 enables FIQ */
+#define IRQ_FIQ_SOURCE_MASK     0x7F
+#define IRQ_FIQ_ENABLE          (1 << 7)
+
+/* System timer channel used by fiq_systimer_start() */
+#define FIQ_SYSTIMER_CHANNEL    1
+
+/* CLO edges sampled to pin the CLO-to-CNTPCT offset */
+#define FIQ_SYSTIMER_CAL_EDGES  16
+
+/* Defined in startup_rpi2.S - r9_fiq points at fiq_handler_fn */
+extern volatile fiq_handler_t fiq_handler_fn;
+extern volatile uint32_t fiq_entry_stamp;
+
+/* Producer and consumer indices on separate cache lines */
+static struct {
+    volatile uint32_t head __attribute__((aligned(64)));   /* Written by FIQ only */
+    volatile uint32_t dropped;
+    volatile uint32_t tail __attribute__((aligned(64)));   /* Written by consumer only */
+    fiq_event_t events[FIQ_RING_SIZE] __attribute__((aligned(64)));
+} fiq_ring;
+
+static uint32_t fiq_systimer_period;
+
+/* CNTPCT (low word) at the start of CLO tick fiq_cal_clo */
+static uint32_t fiq_cal_clo;
+static uint32_t fiq_cal_cntpct;
+
+static inline void fiq_dmb(void) {
+    __asm volatile("dmb" ::: "memory");
+}
+
+/* ========== Routing ========== */
+
+int fiq_route(uint32_t vc_irq, fiq_handler_t handler) {
+    if (vc_irq > 63 || handler == NULL) {
+        return 0;
+    }
+
+    /* Never deliver the source as both IRQ and FIQ */
+    bcm2837_disable_vc_irq(vc_irq);
+
+    IRQ_VC_WRITE(IRQ_FIQ_CONTROL, 0);
+    fiq_handler_fn = handler;
+    fiq_dmb();
+    IRQ_VC_WRITE(IRQ_FIQ_CONTROL, IRQ_FIQ_ENABLE | (vc_irq & IRQ_FIQ_SOURCE_MASK));
+    return 1;
+}
+
+void fiq_unroute(void) {
+    IRQ_VC_WRITE(IRQ_FIQ_CONTROL, 0);
+    fiq_dmb();
+    fiq_handler_fn = NULL;
+}
+
+/* ========== FIQ-to-Task Ring ========== */
+
+HOT_FUNC void fiq_ring_push(uint32_t data) {
+    uint32_t head = fiq_ring.head;
+
+    if (head - fiq_ring.tail >= FIQ_RING_SIZE) {
+        fiq_ring.dropped++;
+        return;
+    }
+
+    fiq_event_t *ev = &fiq_ring.events[head & (FIQ_RING_SIZE - 1)];
+    ev->stamp = fiq_entry_stamp;
+    ev->data = data;
+    fiq_dmb();                  /* Event visible before the index */
+    fiq_ring.head = head + 1;
+}
+
+int fiq_ring_pop(fiq_event_t *ev) {
+    uint32_t tail = fiq_ring.tail;
+
+    if (tail == fiq_ring.head) {
+        return 0;
+    }
+    fiq_dmb();                  /* Index read before the event */
+
+    *ev = fiq_ring.events[tail & (FIQ_RING_SIZE - 1)];
+    fiq_dmb();                  /* Event copied before the slot is released */
+    fiq_ring.tail = tail + 1;
+    return 1;
+}
+
+uint32_t fiq_ring_dropped(void) {
+    return fiq_ring.dropped;
+}
+
+/* ========== System Timer Source ========== */
+
+HOT_FUNC static void fiq_systimer_handler(void) {
+    uint32_t due = SYSTIMER_REG(SYSTIMER_CMP(FIQ_SYSTIMER_CHANNEL));
+
+    SYSTIMER_WRITE(SYSTIMER_CS, SYSTIMER_CS_MATCH(FIQ_SYSTIMER_CHANNEL));
+    SYSTIMER_WRITE(SYSTIMER_CMP(FIQ_SYSTIMER_CHANNEL), due + fiq_systimer_period);
+
+    fiq_ring_push(due);
+}
+
+/*
+ * Both counters run off the 19.2 MHz crystal, so CNTPCT time of a CLO
+ * value is a fixed offset plus 19.2 ticks per microsecond. The offset is
+ * taken at CLO edges: CNTPCT read right after CLO is seen to change is
+ * late by at most one CLO read, and the earliest of several is kept.
+ */
+static void fiq_systimer_calibrate(void) {
+    uint32_t cpsr = cpu_irq_save();
+    uint32_t best = 0;
+
+    for (int i = 0; i < FIQ_SYSTIMER_CAL_EDGES; i++) {
+        uint32_t clo = SYSTIMER_REG(SYSTIMER_CLO);
+        uint32_t edge;
+
+        while ((edge = SYSTIMER_REG(SYSTIMER_CLO)) == clo) {}
+        uint32_t stamp = (uint32_t)cpu_cntpct();
+
+        if (i == 0) {
+            fiq_cal_clo = edge;
+            best = stamp;
+            continue;
+        }
+        /* This edge's stamp mapped back onto the first edge's CLO value */
+        uint32_t base = stamp - (uint32_t)((uint64_t)(edge - fiq_cal_clo) * CPU_CNTPCT_HZ / 1000000);
+        if ((int32_t)(base - best) < 0) {
+            best = base;
+        }
+    }
+    fiq_cal_cntpct = best;
+    cpu_irq_restore(cpsr);
+}
+
+uint32_t fiq_systimer_latency(const fiq_event_t *ev) {
+    uint32_t due = fiq_cal_cntpct +
+                   (uint32_t)((uint64_t)(ev->data - fiq_cal_clo) * CPU_CNTPCT_HZ / 1000000);
+    int32_t latency = (int32_t)(ev->stamp - due);
+
+    return latency > 0 ? (uint32_t)latency : 0;
+}
+
+void fiq_systimer_start(uint32_t period_us) {
+    fiq_systimer_period = period_us;
+    fiq_systimer_calibrate();
+
+    SYSTIMER_WRITE(SYSTIMER_CS, SYSTIMER_CS_MATCH(FIQ_SYSTIMER_CHANNEL));
+    SYSTIMER_WRITE(SYSTIMER_CMP(FIQ_SYSTIMER_CHANNEL), SYSTIMER_REG(SYSTIMER_CLO) + period_us);
+    fiq_route(IRQ_SYSTEM_TIMER_0 + FIQ_SYSTIMER_CHANNEL, fiq_systimer_handler);
+}
+
+void fiq_systimer_stop(void) {
+    fiq_unroute();
+    SYSTIMER_WRITE(SYSTIMER_CS, SYSTIMER_CS_MATCH(FIQ_SYSTIMER_CHANNEL));
+}
@@ -0,0 +1,68 @@
+/*
+ * FIQ fast path for RPi2 BCM2837
+ *
+ * Routes exactly one VideoCore interrupt source (GPIO bank, system timer
+ * compare, ...) to FIQ via IRQ_FIQ_CONTROL. The FIQ vector in
+ * startup_rpi2.S calls the installed handler directly: no FreeRTOS
+ * interrupt entry, no GIC stub, and only r0-r3/r12/lr are saved because
+ * r8-r12 are banked in FIQ mode. The FreeRTOS port never masks FIQ, so the
+ * handler also runs inside kernel critical sections.
+ *
+ * Consequently FIQ handlers must not call any FreeRTOS API (including
+ * FromISR variants) and must be integer-only. Data reaches tasks through
+ * the lock-free single-producer/single-consumer ring below, which tasks
+ * drain with fiq_ring_pop().
+ */
+
+#ifndef FIQ_H
+#define FIQ_H
+
+#include <stdint.h>
+
+/* Ring capacity in events - power of two */
+#define FIQ_RING_SIZE       256
+
+typedef void (*fiq_handler_t)(void);
+
+/* One event handed from FIQ to task context */
+typedef struct {
+    uint32_t stamp;     /* Low word of CNTPCT at FIQ entry (52 ns units) */
+    uint32_t data;      /* Handler-defined payload */
+} fiq_event_t;
+
+/*
+ * Route VideoCore IRQ vc_irq (0-63) to FIQ and install handler.
+ * Any previously routed source is replaced. The source is disabled as an
+ * IRQ so it is only ever delivered as FIQ. Returns 0 on a bad argument.
+ */
+int fiq_route(uint32_t vc_irq, fiq_handler_t handler);
+
+/* Stop routing to FIQ and uninstall the handler */
+void fiq_unroute(void);
+
+/* Producer side - call only from the FIQ handler */
+void fiq_ring_push(uint32_t data);
+
+/* Consumer side - returns 1 and fills ev if an event was pending */
+int fiq_ring_pop(fiq_event_t *ev);
+
+/* Events lost because the ring was full */
+uint32_t fiq_ring_dropped(void);
+
+/*
+ * System timer compare 1 as FIQ source: fires every period_us and pushes
+ * the compare value it matched (C1, 1 MHz units) as event data. Used by
+ * the FIQ latency benchmark.
+ */
+void fiq_systimer_start(uint32_t period_us);
+void fiq_systimer_stop(void);
+
+/*
+ * Match-to-entry latency of a fiq_systimer event in CNTPCT ticks (52 ns),
+ * from the entry stamp and the compare value converted to CNTPCT time.
+ * fiq_systimer_start() pins the CLO-to-CNTPCT offset to within one CLO
+ * read; the residue makes the figure read low by that much at most.
+ */
+uint32_t fiq_systimer_latency(const fiq_event_t *ev);
+
+#endif /* FIQ_H */
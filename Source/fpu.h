@@ -0,0 +1,50 @@
+/*
+ * Lazy VFP/NEON context switching for RPi2 BCM2837
+ *
+ * The ARM_CA9 port (configUSE_TASK_FPU_SUPPORT == 1) only saves and
+ * restores D0-D31/FPSCR for tasks whose ulPortTaskHasFPUContext flag is
+ * set. On top of that:
+ *
+ * - On every switch-in (traceTASK_SWITCHED_IN) FPEXC.EN is set to the
+ *   incoming task's saved flag, so a task without FPU context runs with
+ *   the FPU disabled.
+ * - The first VFP/NEON instruction such a task executes traps to
+ *   undefined_handler (startup_rpi2.S), which enables the FPU, gives the
+ *   task a fresh FPU context and re-executes the instruction. From then
+ *   on the task's FPU registers are part of its context.
+ * - Tasks that are known to use the FPU can opt in up front with
+ *   APP_TASK_FPU (app_tasks.h) or portTASK_USES_FLOATING_POINT().
+ *
+ *
+ * Interrupt handlers must stay integer-only - see vApplicationIRQHandler.
+ * They run on the interrupted task's D registers and FPEXC: a VFP/NEON
+ * instruction there either corrupts the FPU owner's registers or, with
+ * FPEXC.EN clear, traps in IRQ/FIQ mode. That covers everything a handler
+ * can reach, including memcpy/memset and the kernel's FromISR paths, and
+ * the compiler's own use of the FPU: auto-vectorised loops and 64-bit
+ * moves through D registers. build_rpi2.sh therefore compiles every C
+ * file with -mgeneral-regs-only. Code that computes in floating point
+ * goes in its own file, listed in FPU_SOURCES there, and must never be
+ * called from an interrupt handler.
+ */
+
+#ifndef FPU_H
+#define FPU_H
+
+#include <stdint.h>
+
+#define FPEXC_EN    (1u << 30)
+
+/* Number of first-use traps taken (defined in startup_rpi2.S) */
+extern volatile uint32_t fpu_lazy_trap_count;
+
+/*
+ * Called from traceTASK_SWITCHED_IN with the first word of the incoming
+ * task's saved context - the port stores ulPortTaskHasFPUContext there.
+ */
+static inline void fpu_lazy_switch_in(uint32_t has_fpu_context) {
+    uint32_t fpexc = has_fpu_context ? FPEXC_EN : 0;
+    __asm volatile("vmsr fpexc, %0" :: "r" (fpexc) : "memory");
+}
+
+#endif /* FPU_H */
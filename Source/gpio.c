@@ -0,0 +1,202 @@
+/*
+ * GPIO Driver for RPi2 BCM2837
+ */
+
+#include "gpio.h"
+#include "bcm2837_gpio.h"
+#include "bcm2837_irq.h"
+#include "cpu.h"
+#include "mmio.h"
+#include "placement.h"
+#include <stddef.h>
+
+/* Single-producer (bank IRQ) / single-consumer (task) event queue */
+typedef struct {
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile uint32_t overflows;
+    TaskHandle_t notify;
+    gpio_event_t events[GPIO_EVENT_QUEUE_DEPTH];
+} gpio_queue_t;
+
+static gpio_queue_t gpio_queues[GPIO_NUM_PINS] ISR_DATA;
+
+/* Orders the queue slot against head/tail - normal memory, not MMIO */
+static inline void gpio_dmb(void) {
+#ifdef HOST_SIM
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#else
+    __asm volatile("dmb" ::: "memory");
+#endif
+}
+
+/* GPPUD/GPPUDCLK need 150 cycles of setup and hold */
+static void gpio_wait_cycles(unsigned int n) {
+    while (n--) {
+        __asm volatile("nop");
+    }
+}
+
+/* ========== Pin Configuration ========== */
+
+void gpio_set_function(unsigned int pin, gpio_func_t func) {
+    if (pin >= GPIO_NUM_PINS) {
+        return;
+    }
+
+    uint32_t cpsr = cpu_irq_save();
+    mmio_write_field(GPFSEL(pin / 10), (pin % 10) * GPFSEL_WIDTH, GPFSEL_WIDTH, (uint32_t)func);
+    cpu_irq_restore(cpsr);
+}
+
+void gpio_set_pull(unsigned int pin, gpio_pull_t pull) {
+    if (pin >= GPIO_NUM_PINS) {
+        return;
+    }
+
+    /* BCM2837 sequence: set control, clock it into the pin, release both */
+    uint32_t cpsr = cpu_irq_save();
+    mmio_write(GPPUD, (uint32_t)pull);
+    gpio_wait_cycles(150);
+    mmio_write(GPPUDCLK(GPIO_BANK(pin)), GPIO_BIT(pin));
+    gpio_wait_cycles(150);
+    mmio_write(GPPUD, 0);
+    mmio_write(GPPUDCLK(GPIO_BANK(pin)), 0);
+    cpu_irq_restore(cpsr);
+}
+
+/* ========== Pin Access ========== */
+
+void gpio_write(unsigned int pin, int level) {
+    if (pin >= GPIO_NUM_PINS) {
+        return;
+    }
+    mmio_write(level ? GPSET(GPIO_BANK(pin)) : GPCLR(GPIO_BANK(pin)), GPIO_BIT(pin));
+}
+
+int gpio_read(unsigned int pin) {
+    if (pin >= GPIO_NUM_PINS) {
+        return 0;
+    }
+    return (mmio_read(GPLEV(GPIO_BANK(pin))) & GPIO_BIT(pin)) != 0;
+}
+
+uint32_t gpio_read_bank(unsigned int bank) {
+    return (bank < GPIO_NUM_BANKS) ? mmio_read(GPLEV(bank)) : 0;
+}
+
+void gpio_write_bank(unsigned int bank, uint32_t set_mask, uint32_t clear_mask) {
+    if (bank >= GPIO_NUM_BANKS) {
+        return;
+    }
+    /* GPSET/GPCLR are write-1 registers - no read-modify-write needed */
+    if (set_mask) {
+        mmio_write(GPSET(bank), set_mask);
+    }
+    if (clear_mask) {
+        mmio_write(GPCLR(bank), clear_mask);
+    }
+}
+
+/* ========== Edge Capture ========== */
+
+/* Update one bit in an edge-enable register (read-modify-write) */
+static void gpio_edge_bit(uintptr_t reg, uint32_t bit, int enable) {
+    mmio_modify(reg, bit, enable ? bit : 0);
+}
+
+void gpio_edge_enable(unsigned int pin, uint32_t edges, TaskHandle_t notify) {
+    if (pin >= GPIO_NUM_PINS) {
+        return;
+    }
+
+    unsigned int bank = GPIO_BANK(pin);
+    uint32_t bit = GPIO_BIT(pin);
+    int async = (edges & GPIO_EDGE_ASYNC) != 0;
+
+    uint32_t cpsr = cpu_irq_save();
+    gpio_queues[pin].notify = notify;
+    gpio_edge_bit(GPREN(bank), bit, !async && (edges & GPIO_EDGE_RISING));
+    gpio_edge_bit(GPFEN(bank), bit, !async && (edges & GPIO_EDGE_FALLING));
+    gpio_edge_bit(GPAREN(bank), bit, async && (edges & GPIO_EDGE_RISING));
+    gpio_edge_bit(GPAFEN(bank), bit, async && (edges & GPIO_EDGE_FALLING));
+    mmio_write(GPEDS(bank), bit);   /* Drop any stale event */
+    cpu_irq_restore(cpsr);
+}
+
+void gpio_edge_disable(unsigned int pin) {
+    gpio_edge_enable(pin, 0, NULL);
+}
+
+int gpio_event_pop(unsigned int pin, gpio_event_t *ev) {
+    if (pin >= GPIO_NUM_PINS) {
+        return 0;
+    }
+
+    gpio_queue_t *q = &gpio_queues[pin];
+    uint32_t tail = q->tail;
+    if (tail == q->head) {
+        return 0;
+    }
+    gpio_dmb();
+
+    *ev = q->events[tail & (GPIO_EVENT_QUEUE_DEPTH - 1)];
+    gpio_dmb();
+    q->tail = tail + 1;
+    return 1;
+}
+
+uint32_t gpio_event_overflows(unsigned int pin) {
+    return (pin < GPIO_NUM_PINS) ? gpio_queues[pin].overflows : 0;
+}
+
+/*
+ * Bank interrupt: one GPEDS read, one CNTPCT read and one GPLEV read per
+ * batch, however many pins fired. Events are acknowledged with the exact
+ * mask that was read, so an edge arriving meanwhile raises a new IRQ.
+ */
+HOT_FUNC static void gpio_bank_irq(void *context) {
+    unsigned int bank = (unsigned int)(uintptr_t)context;
+    BaseType_t woken = pdFALSE;
+
+    uint32_t events = mmio_read(GPEDS(bank));
+    uint64_t stamp = cpu_cntpct();
+    uint32_t levels = mmio_read(GPLEV(bank));
+    mmio_write(GPEDS(bank), events);
+
+    while (events) {
+        uint32_t bit = __builtin_ctz(events);
+        unsigned int pin = (bank << 5) + bit;
+        events &= events - 1;
+
+        if (pin >= GPIO_NUM_PINS) {
+            continue;
+        }
+
+        gpio_queue_t *q = &gpio_queues[pin];
+        uint32_t head = q->head;
+        if (head - q->tail >= GPIO_EVENT_QUEUE_DEPTH) {
+            q->overflows++;
+        } else {
+            gpio_event_t *ev = &q->events[head & (GPIO_EVENT_QUEUE_DEPTH - 1)];
+            ev->stamp = stamp;
+            ev->level = (levels >> bit) & 1;
+            gpio_dmb();
+            q->head = head + 1;
+        }
+
+        if (q->notify) {
+            vTaskNotifyGiveFromISR(q->notify, &woken);
+        }
+    }
+
+    portYIELD_FROM_ISR(woken);
+}
+
+COLD_FUNC void gpio_init(void) {
+    for (unsigned int bank = 0; bank < GPIO_NUM_BANKS; bank++) {
+        mmio_write(GPEDS(bank), 0xFFFFFFFF);
+        bcm2837_irq_register(IRQ_GPIO_0 + bank, gpio_bank_irq, (void *)(uintptr_t)bank);
+        bcm2837_enable_vc_irq(IRQ_GPIO_0 + bank);
+    }
+}
@@ -0,0 +1,82 @@
+/*
+ * GPIO Driver for RPi2 BCM2837
+ * 54 pins in two banks (0-31, 32-53) at 0x3F200000
+ *
+ * Edge capture is interrupt driven: the bank handler reads the event
+ * detect status once, stamps the whole batch with a single CNTPCT read,
+ * and appends one event per pin to that pin's lock-free queue. A task
+ * can be notified per pin, so no polling task is needed. Two edges on
+ * the same pin between bank interrupts are merged by the hardware.
+ */
+
+#ifndef GPIO_H
+#define GPIO_H
+
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define GPIO_NUM_PINS           54
+#define GPIO_NUM_BANKS          2
+
+/* Events buffered per pin - power of two */
+#define GPIO_EVENT_QUEUE_DEPTH  16
+
+/* GPFSEL function codes */
+typedef enum {
+    GPIO_FUNC_INPUT  = 0,
+    GPIO_FUNC_OUTPUT = 1,
+    GPIO_FUNC_ALT0   = 4,
+    GPIO_FUNC_ALT1   = 5,
+    GPIO_FUNC_ALT2   = 6,
+    GPIO_FUNC_ALT3   = 7,
+    GPIO_FUNC_ALT4   = 3,
+    GPIO_FUNC_ALT5   = 2
+} gpio_func_t;
+
+/* GPPUD pull control codes */
+typedef enum {
+    GPIO_PULL_NONE = 0,
+    GPIO_PULL_DOWN = 1,
+    GPIO_PULL_UP   = 2
+} gpio_pull_t;
+
+/* gpio_edge_enable() flags */
+#define GPIO_EDGE_RISING        (1 << 0)
+#define GPIO_EDGE_FALLING       (1 << 1)
+#define GPIO_EDGE_ASYNC         (1 << 2)   /* Asynchronous detect (no clock sampling, catches short pulses) */
+
+typedef struct {
+    uint64_t stamp;     /* CNTPCT when the bank interrupt was serviced */
+    uint32_t level;     /* Pin level read in the same batch (0/1) */
+} gpio_event_t;
+
+/* Register the bank interrupt handlers and enable IRQ_GPIO_0/1 */
+void gpio_init(void);
+
+/* Pin configuration */
+void gpio_set_function(unsigned int pin, gpio_func_t func);
+void gpio_set_pull(unsigned int pin, gpio_pull_t pull);
+
+/* Single-pin access */
+void gpio_write(unsigned int pin, int level);
+int gpio_read(unsigned int pin);
+
+/* Whole-bank access - one register access each */
+uint32_t gpio_read_bank(unsigned int bank);
+void gpio_write_bank(unsigned int bank, uint32_t set_mask, uint32_t clear_mask);
+
+/*
+ * Enable edge capture on pin. notify (may be NULL) gets one
+ * vTaskNotifyGiveFromISR() per batch containing an event for this pin.
+ */
+void gpio_edge_enable(unsigned int pin, uint32_t edges, TaskHandle_t notify);
+void gpio_edge_disable(unsigned int pin);
+
+/* Pop the oldest captured event; returns 0 if the queue is empty */
+int gpio_event_pop(unsigned int pin, gpio_event_t *ev);
+
+/* Events lost because the pin's queue was full */
+uint32_t gpio_event_overflows(unsigned int pin);
+
+#endif /* GPIO_H */
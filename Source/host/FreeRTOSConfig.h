@@ -0,0 +1,115 @@
+/*
+ * FreeRTOS Kernel V10.x.x
+ * Configuration for the host simulation build (FreeRTOS POSIX port on Linux)
+ *
+ * Selected by build_host.sh, which puts Source/host ahead of Source on the
+ * include path. Scheduler, queue and heap settings follow the target
+ * configuration in Source/FreeRTOSConfig.h so the application logic sees
+ * the same kernel; everything tied to the BCM2837 (GIC stub, tick timer,
+ * lazy FPU, .heap placement) is left out.
+ */
+
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+/* The stand-ins in cpu.h, uart.c, trace.h and main.c key off the command line define */
+#ifndef HOST_SIM
+#error "Source/host is for the host simulation build - use build_host.sh"
+#endif
+
+/* Timing - the POSIX port drives the tick from SIGALRM */
+#define configCPU_CLOCK_HZ                      ( ( unsigned long ) 900000000 ) /* Nominal, for reports only */
+#define configTICK_RATE_HZ                      ( ( TickType_t ) 1000 )         /* 1ms tick */
+
+/* Scheduler configuration */
+#define configUSE_PREEMPTION                    1
+#define configUSE_TIME_SLICING                  1
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION 0
+#define configUSE_TICKLESS_IDLE                 0
+#define configMAX_PRIORITIES                    ( 8 )
+#define configMINIMAL_STACK_SIZE                ( ( unsigned short ) 4096 )  /* Words - 32KB, above PTHREAD_STACK_MIN */
+#define configMAX_TASK_NAME_LEN                 ( 16 )
+#define configUSE_16_BIT_TICKS                  0
+#define configIDLE_SHOULD_YIELD                 1
+#define configUSE_TASK_NOTIFICATIONS            1
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES   3
+#define configDRIVER_NOTIFY_INDEX               1   /* Slot used by blocking driver calls (SPI, I2C) */
+#define configCONSOLE_NOTIFY_INDEX              2   /* Slot used by the console receive interrupt (console.h) */
+
+/* Memory allocation configuration */
+#define configSUPPORT_DYNAMIC_ALLOCATION        1
+#define configSUPPORT_STATIC_ALLOCATION         1   /* Boot tasks, idle and timer task - see app_tasks.h */
+#define configTOTAL_HEAP_SIZE                   ( ( size_t ) ( 32 * 1024 * 1024 ) ) /* 32MB */
+#define configAPPLICATION_ALLOCATED_HEAP        0   /* heap_4 owns ucHeap */
+
+/* Hook function configuration */
+#define configUSE_IDLE_HOOK                     1   /* WFI, load accounting, background jobs - see idle.h */
+#define configUSE_TICK_HOOK                     0
+#define configUSE_MALLOC_FAILED_HOOK            1
+#define configUSE_DAEMON_TASK_STARTUP_HOOK      1   /* Boot timeline report */
+#define configCHECK_FOR_STACK_OVERFLOW          2
+#define configUSE_STACK_GUARD                   0   /* No MMU - the pattern check stays on */
+
+/* Run time and task stats gathering - the counter is CNTPCT / 256
+ * (75 kHz, 32 bits wrap after 15.9 hours); the shell's ps takes deltas */
+#define configGENERATE_RUN_TIME_STATS           1
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()    /* CNTPCT always runs */
+#define portGET_RUN_TIME_COUNTER_VALUE()        ( ( uint32_t ) ( cpu_cntpct() >> 8 ) )
+#define configUSE_TRACE_FACILITY                1
+#define configUSE_STATS_FORMATTING_FUNCTIONS    1
+
+/* Co-routine configuration */
+#define configUSE_CO_ROUTINES                   0
+#define configMAX_CO_ROUTINE_PRIORITIES         ( 2 )
+
+/* Software timer configuration */
+#define configUSE_TIMERS                        1
+#define configTIMER_TASK_PRIORITY               ( configMAX_PRIORITIES - 1 )
+#define configTIMER_QUEUE_LENGTH                10
+#define configTIMER_TASK_STACK_DEPTH            ( configMINIMAL_STACK_SIZE * 2 )
+
+/* Queue and semaphore configuration */
+#define configQUEUE_REGISTRY_SIZE               8
+#define configUSE_QUEUE_SETS                    1
+#define configUSE_MUTEXES                       1
+#define configUSE_RECURSIVE_MUTEXES             1
+#define configUSE_COUNTING_SEMAPHORES           1
+
+/* Optional functions */
+#define INCLUDE_vTaskPrioritySet                1
+#define INCLUDE_uxTaskPriorityGet               1
+#define INCLUDE_vTaskDelete                     1
+#define INCLUDE_vTaskSuspend                    1
+#define INCLUDE_xResumeFromISR                  1
+#define INCLUDE_vTaskDelayUntil                 1
+#define INCLUDE_vTaskDelay                      1
+#define INCLUDE_xTaskGetSchedulerState          1
+#define INCLUDE_xTaskGetCurrentTaskHandle       1
+#define INCLUDE_uxTaskGetStackHighWaterMark     1
+#define INCLUDE_xTaskGetIdleTaskHandle          1
+#define INCLUDE_eTaskGetState                   1
+#define INCLUDE_xEventGroupSetBitFromISR        1
+#define INCLUDE_xTimerPendFunctionCall          1
+#define INCLUDE_xTaskAbortDelay                 1
+#define INCLUDE_xTaskGetHandle                  1
+
+/* Flight recorder: same ring and hooks as the target, stamped from CLOCK_MONOTONIC */
+#define configUSE_FLIGHT_RECORDER               1
+
+/* IRQ statistics for handlers fired with host_irq_raise() (no tick source) */
+#define configUSE_IRQ_STATS                     1
+
+/* Allocation histogram and stack high-water sampling - host figures, not for the target build */
+#define configUSE_MEMSTAT                       1
+
+/* Trace hooks - expanded inside tasks.c, queue.c and heap_4.c (no lazy FPU on the host) */
+#include "trace.h"
+#include "memstat.h"
+#define traceTASK_SWITCHED_IN()                 TRACE_TASK_SWITCHED_IN()
+
+/* Assertion configuration */
+/* cold: every configASSERT() failure branch is laid out as unlikely, out of line */
+extern void vAssertCalled( unsigned long ulLine, const char * const pcFileName ) __attribute__( ( cold ) );
+#define configASSERT( x ) if( ( x ) == 0 ) vAssertCalled( __LINE__, __FILE__ )
+
+#endif /* FREERTOS_CONFIG_H */
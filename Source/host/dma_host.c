@@ -0,0 +1,127 @@
+/*
+ * Host Simulation DMA Memory Service
+ * dma.h memory service on memcpy/memset
+ *
+ * Every request completes inside the *_async() call: status, t_done, the
+ * done callback and the notification are all delivered before it returns,
+ * and the return value is still DMA_OP_PENDING so callers take the same
+ * path as on the target. Argument checks match dma.c. Caller-built chains
+ * (dma_submit) hold bus addresses and are refused.
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "dma.h"
+#include "cpu.h"
+#include <stdint.h>
+#include <string.h>
+
+void dma_init(void) {
+}
+
+static int dma_op_invalid(dma_op_t *op) {
+    op->status = DMA_OP_INVALID;
+    return DMA_OP_INVALID;
+}
+
+static int dma_op_complete(dma_op_t *op) {
+    op->t_done = (uint32_t)cpu_cntpct();
+    op->status = DMA_OP_OK;
+    if (op->done) {
+        op->done(op);
+    }
+    if (op->notify) {
+        xTaskNotifyGiveIndexed(op->notify, configDRIVER_NOTIFY_INDEX);
+    }
+    return DMA_OP_PENDING;
+}
+
+static void dma_op_begin(dma_op_t *op) {
+    op->chain = NULL;
+    op->queue_next = NULL;
+    op->t_submit = (uint32_t)cpu_cntpct();
+    op->status = DMA_OP_PENDING;
+}
+
+int dma_submit(dma_op_t *op) {
+    return dma_op_invalid(op);
+}
+
+int dma_memcpy_async(dma_op_t *op, void *dst, const void *src, size_t len) {
+    if (len == 0 || (((uintptr_t)dst | (uintptr_t)src | len) & 3)) {
+        return dma_op_invalid(op);
+    }
+
+    dma_op_begin(op);
+    memcpy(dst, src, len);
+    return dma_op_complete(op);
+}
+
+int dma_fill32_async(dma_op_t *op, void *dst, uint32_t pattern, size_t len) {
+    if (len == 0 || (((uintptr_t)dst | len) & 3)) {
+        return dma_op_invalid(op);
+    }
+
+    dma_op_begin(op);
+    for (size_t i = 0; i < len / 4; i++) {
+        ((uint32_t *)dst)[i] = pattern;
+    }
+    return dma_op_complete(op);
+}
+
+int dma_memset_async(dma_op_t *op, void *dst, uint8_t value, size_t len) {
+    return dma_fill32_async(op, dst, value * 0x01010101u, len);
+}
+
+int dma_copy2d_async(dma_op_t *op, void *dst, uint32_t dst_pitch,
+                     const void *src, uint32_t src_pitch, uint32_t width, uint32_t rows) {
+    int32_t src_stride = (int32_t)(src_pitch - width);
+    int32_t dst_stride = (int32_t)(dst_pitch - width);
+
+    if (width == 0 || width > 0xFFFF || rows == 0 || rows > 0x4000 ||
+        src_stride < -32768 || src_stride > 32767 || dst_stride < -32768 || dst_stride > 32767 ||
+        (((uintptr_t)dst | (uintptr_t)src | width | src_pitch | dst_pitch) & 3)) {
+        return dma_op_invalid(op);
+    }
+
+    dma_op_begin(op);
+    for (uint32_t row = 0; row < rows; row++) {
+        memcpy((uint8_t *)dst + row * dst_pitch, (const uint8_t *)src + row * src_pitch, width);
+    }
+    return dma_op_complete(op);
+}
+
+/* ========== Blocking Forms ========== */
+
+static int dma_op_wait(dma_op_t *op, int queued) {
+    if (queued != DMA_OP_PENDING) {
+        return queued;
+    }
+    ulTaskNotifyTakeIndexed(configDRIVER_NOTIFY_INDEX, pdTRUE, 0);
+    return op->status;
+}
+
+static void dma_op_prepare(dma_op_t *op) {
+    op->done = NULL;
+    op->context = NULL;
+    op->notify = xTaskGetCurrentTaskHandle();
+    ulTaskNotifyTakeIndexed(configDRIVER_NOTIFY_INDEX, pdTRUE, 0);    /* Drop a stale give */
+}
+
+int dma_memcpy(void *dst, const void *src, size_t len) {
+    dma_op_t op;
+    dma_op_prepare(&op);
+    return dma_op_wait(&op, dma_memcpy_async(&op, dst, src, len));
+}
+
+int dma_memset(void *dst, uint8_t value, size_t len) {
+    dma_op_t op;
+    dma_op_prepare(&op);
+    return dma_op_wait(&op, dma_memset_async(&op, dst, value, len));
+}
+
+int dma_fill32(void *dst, uint32_t pattern, size_t len) {
+    dma_op_t op;
+    dma_op_prepare(&op);
+    return dma_op_wait(&op, dma_fill32_async(&op, dst, pattern, len));
+}
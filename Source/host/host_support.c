@@ -0,0 +1,186 @@
+/*
+ * Host Simulation Support
+ * Stand-ins for rpi2_support.c, startup_rpi2.S and the peripheral drivers
+ *
+ * Linked instead of rpi2_support.c by build_host.sh. The FreeRTOS hooks
+ * and static kernel task memory match the target. Drivers built for the
+ * host (gpio.c) run against the mmio.h mock registers and their handlers
+ * are fired with host_irq_raise(); the peripherals left out of the host
+ * build (SPI, I2C, system timer) initialise to nothing, so main.c runs
+ * unchanged.
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "bcm2837_irq.h"
+#include "uart.h"
+#include "app_tasks.h"
+#include "boot_trace.h"
+#include "spi.h"
+#include "i2c.h"
+#include "hrtimer.h"
+#include "mmu.h"
+#include "trace.h"
+#include "cpu.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+/* ========== Boot Trace Storage ========== */
+
+/* Defined in startup_rpi2.S on the target */
+volatile uint64_t boot_stamps[BOOT_PHASE_COUNT];
+volatile uint32_t boot_mark_count;
+volatile char boot_marks[BOOT_MARKS_MAX];
+
+/* Process start stands in for the reset vector */
+__attribute__((constructor)) static void host_boot_entry(void) {
+    boot_trace_mark(BOOT_PHASE_ENTRY);
+}
+
+/* ========== FreeRTOS Hooks ========== */
+
+void vAssertCalled(unsigned long ulLine, const char * const pcFileName) {
+    trace_event(TRACE_EV_ASSERT, 0, ulLine, (uint32_t)(uintptr_t)pcFileName);
+    uart_printf("\nASSERT FAILED at %s:%u\n", pcFileName, (uint32_t)ulLine);
+    trace_dump();
+    abort();
+}
+
+void vApplicationStackOverflowHook(TaskHandle_t xTask, char *pcTaskName) {
+    trace_event(TRACE_EV_STACK_OVERFLOW, 0, (uint32_t)(uintptr_t)xTask, 0);
+    uart_printf("\nSTACK OVERFLOW in %s\n", pcTaskName);
+    abort();
+}
+
+void vApplicationMallocFailedHook(void) {
+    trace_event(TRACE_EV_MALLOC_FAILED, 0, 0, 0);
+    uart_puts("\nMALLOC FAILED\n");
+    abort();
+}
+
+void vApplicationDaemonTaskStartupHook(void) {
+    boot_trace_mark(BOOT_PHASE_FIRST_TASK);
+    boot_trace_report();
+}
+
+/* ========== Static Memory for Kernel Tasks ========== */
+
+APP_TASK_TCB(idle_task_tcb);
+APP_TASK_STACK(idle_task_stack, IDLE_TASK_STACK_DEPTH);
+
+APP_TASK_TCB(timer_task_tcb);
+APP_TASK_STACK(timer_task_stack, configTIMER_TASK_STACK_DEPTH);
+
+void vApplicationGetIdleTaskMemory(StaticTask_t **ppxIdleTaskTCBBuffer,
+                                   StackType_t **ppxIdleTaskStackBuffer,
+                                   uint32_t *pulIdleTaskStackSize) {
+    *ppxIdleTaskTCBBuffer = &idle_task_tcb;
+    *ppxIdleTaskStackBuffer = idle_task_stack.stack;
+    *pulIdleTaskStackSize = IDLE_TASK_STACK_DEPTH;
+}
+
+void vApplicationGetTimerTaskMemory(StaticTask_t **ppxTimerTaskTCBBuffer,
+                                    StackType_t **ppxTimerTaskStackBuffer,
+                                    uint32_t *pulTimerTaskStackSize) {
+    *ppxTimerTaskTCBBuffer = &timer_task_tcb;
+    *ppxTimerTaskStackBuffer = timer_task_stack.stack;
+    *pulTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
+}
+
+/* ========== Interrupt Controller ========== */
+/*
+ * The only real host interrupt is the POSIX port's SIGALRM tick.
+ * Peripheral handlers run when a test calls host_irq_raise().
+ */
+
+static struct {
+    bcm2837_irq_handler_t handler;
+    void *context;
+    uint32_t enabled;
+} host_irq_handlers[BCM2837_VC_IRQ_COUNT];
+
+void bcm2837_irq_init(void) {
+}
+
+void bcm2837_enable_vc_irq(uint32_t irq_num) {
+    if (irq_num < BCM2837_VC_IRQ_COUNT) {
+        host_irq_handlers[irq_num].enabled = 1;
+    }
+}
+
+void bcm2837_disable_vc_irq(uint32_t irq_num) {
+    if (irq_num < BCM2837_VC_IRQ_COUNT) {
+        host_irq_handlers[irq_num].enabled = 0;
+    }
+}
+
+void bcm2837_irq_register(uint32_t irq_num, bcm2837_irq_handler_t handler, void *context) {
+    if (irq_num >= BCM2837_VC_IRQ_COUNT) {
+        return;
+    }
+    host_irq_handlers[irq_num].context = context;
+    host_irq_handlers[irq_num].handler = handler;
+}
+
+static bcm2837_irq_stats_t host_irq_stats[BCM2837_IRQ_STATS_COUNT];
+
+int host_irq_raise(uint32_t irq_num) {
+    if (irq_num >= BCM2837_VC_IRQ_COUNT || !host_irq_handlers[irq_num].enabled ||
+        !host_irq_handlers[irq_num].handler) {
+        return 0;
+    }
+
+    TRACE_ISR_ENTER(ARM_LOCAL_IRQ_SRC_GPU);
+    uint64_t start = cpu_cntpct();
+    host_irq_handlers[irq_num].handler(host_irq_handlers[irq_num].context);
+    uint32_t run = (uint32_t)(cpu_cntpct() - start);
+    TRACE_ISR_EXIT();
+
+    /* Raised synchronously, so there is no latency to report */
+    bcm2837_irq_stats_t *st = &host_irq_stats[irq_num];
+    st->count++;
+    st->run_total += run;
+    if (run > st->run_max) {
+        st->run_max = run;
+    }
+    return 1;
+}
+
+int bcm2837_irq_get_stats(uint32_t source, bcm2837_irq_stats_t *stats) {
+    if (source >= BCM2837_IRQ_STATS_COUNT) {
+        return 0;
+    }
+    uint32_t cpsr = cpu_irq_save();
+    *stats = host_irq_stats[source];
+    cpu_irq_restore(cpsr);
+    return 1;
+}
+
+void bcm2837_irq_stats_reset(void) {
+    uint32_t cpsr = cpu_irq_save();
+    for (uint32_t i = 0; i < BCM2837_IRQ_STATS_COUNT; i++) {
+        host_irq_stats[i] = (bcm2837_irq_stats_t){0};
+    }
+    cpu_irq_restore(cpsr);
+}
+
+/* ========== Peripherals ========== */
+
+void spi_init(void) {
+}
+
+void i2c_init(uint32_t bus_hz) {
+    (void)bus_hz;
+}
+
+void hrtimer_init(void) {
+}
+
+/* ========== Memory Map ========== */
+
+/* No target address space on the host - shell "mem" refuses everything */
+int mmu_addr_accessible(uint32_t addr, uint32_t len) {
+    (void)addr;
+    (void)len;
+    return 0;
+}
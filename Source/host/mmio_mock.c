@@ -0,0 +1,127 @@
+/*
+ * Host Simulation Register Mock
+ * Backing store for mmio.h accessors in HOST_SIM builds
+ *
+ * Registers spring into existence on first access with value 0 and keep
+ * whatever was last written, which is enough for configuration paths
+ * (GPFSEL, enable masks). Registers with side effects - write-1-to-clear
+ * status, free-running counters, FIFOs - get read/write hooks from the
+ * test code via mmio_mock_hook(). Access counts let a test check how many
+ * volatile accesses a driver path really makes.
+ */
+
+#include "mmio.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Registers tracked at once - open addressing, power of two */
+#define MMIO_MOCK_SLOTS     1024
+
+#define MMIO_MOCK_HOOKS     16
+
+typedef struct {
+    uintptr_t addr;
+    uint32_t value;
+    uint32_t used;
+} mmio_mock_slot_t;
+
+typedef struct {
+    uintptr_t base;
+    uint32_t size;
+    mmio_mock_read_t read;
+    mmio_mock_write_t write;
+    void *context;
+} mmio_mock_hook_t;
+
+static mmio_mock_slot_t mmio_mock_slots[MMIO_MOCK_SLOTS];
+static mmio_mock_hook_t mmio_mock_hooks[MMIO_MOCK_HOOKS];
+static uint32_t mmio_mock_hook_count;
+static uint32_t mmio_mock_reads, mmio_mock_writes, mmio_mock_barriers;
+
+static mmio_mock_slot_t *mmio_mock_slot(uintptr_t addr) {
+    uint32_t i = (uint32_t)(addr >> 2) & (MMIO_MOCK_SLOTS - 1);
+
+    for (uint32_t n = 0; n < MMIO_MOCK_SLOTS; n++, i = (i + 1) & (MMIO_MOCK_SLOTS - 1)) {
+        mmio_mock_slot_t *s = &mmio_mock_slots[i];
+        if (!s->used) {
+            s->used = 1;
+            s->addr = addr;
+            s->value = 0;
+            return s;
+        }
+        if (s->addr == addr) {
+            return s;
+        }
+    }
+
+    fprintf(stderr, "mmio_mock: more than %u registers touched\n", MMIO_MOCK_SLOTS);
+    abort();
+}
+
+static const mmio_mock_hook_t *mmio_mock_find_hook(uintptr_t addr) {
+    for (uint32_t i = 0; i < mmio_mock_hook_count; i++) {
+        const mmio_mock_hook_t *h = &mmio_mock_hooks[i];
+        if (addr - h->base < h->size) {
+            return h;
+        }
+    }
+    return NULL;
+}
+
+uint32_t mmio_mock_read(uintptr_t addr) {
+    mmio_mock_slot_t *s = mmio_mock_slot(addr);
+    const mmio_mock_hook_t *h = mmio_mock_find_hook(addr);
+
+    mmio_mock_reads++;
+    if (h && h->read) {
+        return h->read(addr, s->value, h->context);
+    }
+    return s->value;
+}
+
+void mmio_mock_write(uintptr_t addr, uint32_t value) {
+    mmio_mock_slot_t *s = mmio_mock_slot(addr);
+    const mmio_mock_hook_t *h = mmio_mock_find_hook(addr);
+
+    mmio_mock_writes++;
+    s->value = (h && h->write) ? h->write(addr, s->value, value, h->context) : value;
+}
+
+void mmio_mock_barrier(void) {
+    __sync_synchronize();
+    mmio_mock_barriers++;
+}
+
+int mmio_mock_hook(uintptr_t base, uint32_t size, mmio_mock_read_t read, mmio_mock_write_t write,
+                   void *context) {
+    if (mmio_mock_hook_count >= MMIO_MOCK_HOOKS) {
+        return 0;
+    }
+    mmio_mock_hooks[mmio_mock_hook_count++] = (mmio_mock_hook_t){ base, size, read, write, context };
+    return 1;
+}
+
+uint32_t mmio_mock_peek(uintptr_t addr) {
+    return mmio_mock_slot(addr)->value;
+}
+
+void mmio_mock_poke(uintptr_t addr, uint32_t value) {
+    mmio_mock_slot(addr)->value = value;
+}
+
+void mmio_mock_counts(uint32_t *reads, uint32_t *writes, uint32_t *barriers) {
+    *reads = mmio_mock_reads;
+    *writes = mmio_mock_writes;
+    *barriers = mmio_mock_barriers;
+}
+
+void mmio_mock_reset(void) {
+    for (uint32_t i = 0; i < MMIO_MOCK_SLOTS; i++) {
+        mmio_mock_slots[i].used = 0;
+    }
+    mmio_mock_hook_count = 0;
+    mmio_mock_reads = 0;
+    mmio_mock_writes = 0;
+    mmio_mock_barriers = 0;
+}
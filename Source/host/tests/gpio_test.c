@@ -0,0 +1,147 @@
+/*
+ * GPIO Edge Capture Test (host)
+ * Drives gpio.c's bank interrupt on the mmio.h mock registers
+ *
+ * GPEDS gets a write-1-to-clear hook, edges are injected by poking the
+ * status and level registers, and the bank handler runs through
+ * host_irq_raise(). The access counts pin the handler's cost - one
+ * GPEDS read, one GPLEV read and one GPEDS write per batch, however
+ * many pins fired. Runs before the scheduler starts; no task is
+ * notified, so nothing here needs it.
+ *
+ * Built and run by TEST=1 ./build_host.sh
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "bcm2837_irq.h"
+#include "gpio.h"
+#include "bcm2837_gpio.h"
+#include "mmio.h"
+#include <stdio.h>
+
+static int failures;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+/* GPEDS: writing 1 clears the bit */
+static uint32_t gpeds_write(uintptr_t addr, uint32_t stored, uint32_t value, void *context) {
+    (void)addr;
+    (void)context;
+    return stored & ~value;
+}
+
+/* Latch edges on pins of one bank, then raise its interrupt; returns the accesses it made */
+static void raise_bank(unsigned int bank, uint32_t edges, uint32_t levels,
+                       uint32_t *reads, uint32_t *writes) {
+    uint32_t r0, w0, b0, r1, w1, b1;
+
+    mmio_mock_poke(GPEDS(bank), mmio_mock_peek(GPEDS(bank)) | edges);
+    mmio_mock_poke(GPLEV(bank), levels);
+
+    mmio_mock_counts(&r0, &w0, &b0);
+    CHECK(host_irq_raise(IRQ_GPIO_0 + bank) == 1);
+    mmio_mock_counts(&r1, &w1, &b1);
+
+    *reads = r1 - r0;
+    *writes = w1 - w0;
+}
+
+static void test_enable(void) {
+    gpio_edge_enable(17, GPIO_EDGE_RISING, NULL);
+    gpio_edge_enable(40, GPIO_EDGE_FALLING, NULL);
+
+    CHECK(mmio_mock_peek(GPREN(0)) & (1u << 17));
+    CHECK(!(mmio_mock_peek(GPFEN(0)) & (1u << 17)));
+    CHECK(mmio_mock_peek(GPFEN(1)) & (1u << 8));
+}
+
+static void test_single_edge(void) {
+    uint32_t reads, writes;
+    gpio_event_t ev;
+
+    raise_bank(0, 1u << 17, 1u << 17, &reads, &writes);
+
+    CHECK(reads == 2);
+    CHECK(writes == 1);
+    CHECK(mmio_mock_peek(GPEDS(0)) == 0);
+
+    CHECK(gpio_event_pop(17, &ev) == 1);
+    CHECK(ev.level == 1);
+    CHECK(ev.stamp != 0);
+    CHECK(gpio_event_pop(17, &ev) == 0);
+}
+
+static void test_batch(void) {
+    uint32_t reads, writes;
+    gpio_event_t a, b;
+
+    gpio_edge_enable(4, GPIO_EDGE_RISING | GPIO_EDGE_FALLING, NULL);
+
+    /* Two pins in one batch: same cost as one, one shared stamp */
+    raise_bank(0, (1u << 4) | (1u << 17), 1u << 4, &reads, &writes);
+
+    CHECK(reads == 2);
+    CHECK(writes == 1);
+    CHECK(mmio_mock_peek(GPEDS(0)) == 0);
+
+    CHECK(gpio_event_pop(4, &a) == 1);
+    CHECK(gpio_event_pop(17, &b) == 1);
+    CHECK(a.level == 1);
+    CHECK(b.level == 0);
+    CHECK(a.stamp == b.stamp);
+
+    /* Bank 1 pin 40 is bit 8 */
+    raise_bank(1, 1u << 8, 0, &reads, &writes);
+    CHECK(reads == 2);
+    CHECK(writes == 1);
+    CHECK(gpio_event_pop(40, &a) == 1);
+    CHECK(a.level == 0);
+}
+
+static void test_overflow(void) {
+    uint32_t reads, writes;
+    gpio_event_t ev;
+    unsigned int popped = 0;
+
+    uint32_t before = gpio_event_overflows(17);
+    for (unsigned int i = 0; i < GPIO_EVENT_QUEUE_DEPTH + 3; i++) {
+        raise_bank(0, 1u << 17, i & 1 ? 1u << 17 : 0, &reads, &writes);
+    }
+    CHECK(gpio_event_overflows(17) - before == 3);
+
+    /* The oldest events are kept, in order */
+    while (gpio_event_pop(17, &ev)) {
+        CHECK(ev.level == (popped & 1));
+        popped++;
+    }
+    CHECK(popped == GPIO_EVENT_QUEUE_DEPTH);
+}
+
+static void test_disable(void) {
+    gpio_edge_disable(17);
+    CHECK(!(mmio_mock_peek(GPREN(0)) & (1u << 17)));
+    CHECK(!(mmio_mock_peek(GPFEN(0)) & (1u << 17)));
+}
+
+int main(void) {
+    mmio_mock_reset();
+    CHECK(mmio_mock_hook(GPEDS(0), 8, NULL, gpeds_write, NULL));
+
+    gpio_init();
+
+    test_enable();
+    test_single_edge();
+    test_batch();
+    test_overflow();
+    test_disable();
+
+    printf("gpio_test: %s (%d failure%s)\n", failures ? "FAILED" : "passed",
+           failures, failures == 1 ? "" : "s");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,263 @@
+/*
+ * High-Resolution Timer Service for RPi2 BCM2837
+ * Min-heap of armed timers on system timer compare channel 3
+ */
+
+#include "FreeRTOS.h"
+#include "timers.h"
+#include "hrtimer.h"
+#include "bcm2837_irq.h"
+#include "bcm2837_systimer.h"
+#include "cpu.h"
+#include "placement.h"
+#include <stddef.h>
+
+#define HRTIMER_CHANNEL         3
+
+/* Longest interval programmed at once - keeps the 32-bit compare unambiguous */
+#define HRTIMER_MAX_PROGRAM_US  0x7FFFFFFFu
+
+static hrtimer_t *hrtimer_heap[HRTIMER_MAX];
+static uint32_t hrtimer_count;
+static hrtimer_stats_t hrtimer_stats;
+
+/* ========== Clock ========== */
+
+uint64_t hrtimer_now(void) {
+    uint32_t hi, lo;
+
+    /* Re-read if CLO wrapped between the two reads */
+    do {
+        hi = SYSTIMER_REG(SYSTIMER_CHI);
+        lo = SYSTIMER_REG(SYSTIMER_CLO);
+    } while (hi != SYSTIMER_REG(SYSTIMER_CHI));
+
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/* ========== Min-Heap ========== */
+
+static void hrtimer_heap_set(uint32_t i, hrtimer_t *t) {
+    hrtimer_heap[i] = t;
+    t->heap_index = (int32_t)i;
+}
+
+static void hrtimer_sift_up(uint32_t i) {
+    hrtimer_t *t = hrtimer_heap[i];
+
+    while (i > 0) {
+        uint32_t parent = (i - 1) / 2;
+        if (hrtimer_heap[parent]->expiry <= t->expiry) {
+            break;
+        }
+        hrtimer_heap_set(i, hrtimer_heap[parent]);
+        i = parent;
+    }
+    hrtimer_heap_set(i, t);
+}
+
+static void hrtimer_sift_down(uint32_t i) {
+    hrtimer_t *t = hrtimer_heap[i];
+
+    for (;;) {
+        uint32_t child = 2 * i + 1;
+        if (child >= hrtimer_count) {
+            break;
+        }
+        if (child + 1 < hrtimer_count &&
+            hrtimer_heap[child + 1]->expiry < hrtimer_heap[child]->expiry) {
+            child++;
+        }
+        if (t->expiry <= hrtimer_heap[child]->expiry) {
+            break;
+        }
+        hrtimer_heap_set(i, hrtimer_heap[child]);
+        i = child;
+    }
+    hrtimer_heap_set(i, t);
+}
+
+static void hrtimer_heap_remove(hrtimer_t *t) {
+    uint32_t i = (uint32_t)t->heap_index;
+    hrtimer_t *last = hrtimer_heap[--hrtimer_count];
+
+    t->heap_index = -1;
+    if (last == t) {
+        return;
+    }
+
+    hrtimer_heap_set(i, last);
+    if (i > 0 && hrtimer_heap[(i - 1) / 2]->expiry > last->expiry) {
+        hrtimer_sift_up(i);
+    } else {
+        hrtimer_sift_down(i);
+    }
+}
+
+static int hrtimer_heap_insert(hrtimer_t *t) {
+    if (hrtimer_count >= HRTIMER_MAX) {
+        hrtimer_stats.heap_full++;
+        return 0;
+    }
+    hrtimer_heap[hrtimer_count] = t;
+    hrtimer_sift_up(hrtimer_count++);
+    return 1;
+}
+
+/* ========== Compare Channel ========== */
+
+/*
+ * Load the compare register with the earliest expiry - IRQs masked.
+ * Returns 1 if that expiry is already (nearly) due and must be run now,
+ * since a compare value the counter has passed only matches after a wrap.
+ */
+static int hrtimer_program(void) {
+    if (hrtimer_count == 0) {
+        return 0;
+    }
+
+    uint64_t now = hrtimer_now();
+    uint64_t expiry = hrtimer_heap[0]->expiry;
+    if (expiry <= now + HRTIMER_MIN_LEAD_US) {
+        return 1;
+    }
+
+    uint64_t delta = expiry - now;
+    uint32_t target = (uint32_t)(delta > HRTIMER_MAX_PROGRAM_US ? now + HRTIMER_MAX_PROGRAM_US : expiry);
+    SYSTIMER_WRITE(SYSTIMER_CMP(HRTIMER_CHANNEL), target);
+
+    /* The counter may have passed target while it was being written */
+    return (int32_t)(SYSTIMER_REG(SYSTIMER_CLO) - target) >= 0;
+}
+
+/*
+ * Make the channel match now-ish so the IRQ runs what is already due -
+ * IRQs masked. A compare written after CLO has reached it only matches
+ * after a full 32-bit wrap (71 minutes), so retry until either the match
+ * is latched or CLO is still short of the value written.
+ */
+static void hrtimer_pend(void) {
+    uint32_t target;
+
+    do {
+        target = SYSTIMER_REG(SYSTIMER_CLO) + HRTIMER_MIN_LEAD_US;
+        SYSTIMER_WRITE(SYSTIMER_CMP(HRTIMER_CHANNEL), target);
+    } while ((int32_t)(SYSTIMER_REG(SYSTIMER_CLO) - target) >= 0 &&
+             !(SYSTIMER_REG(SYSTIMER_CS) & SYSTIMER_CS_MATCH(HRTIMER_CHANNEL)));
+}
+
+/* ========== Dispatch ========== */
+
+static void hrtimer_deferred(void *pv, uint32_t ul) {
+    hrtimer_t *t = (hrtimer_t *)pv;
+    (void)ul;
+    t->callback(t, t->context);
+}
+
+/* Pop and dispatch every due timer, then reprogram - IRQ context */
+HOT_FUNC static void hrtimer_run_due(BaseType_t *woken) {
+    do {
+        uint64_t now = hrtimer_now();
+
+        while (hrtimer_count && hrtimer_heap[0]->expiry <= now + HRTIMER_MIN_LEAD_US) {
+            hrtimer_t *t = hrtimer_heap[0];
+            uint32_t late = now > t->expiry ? (uint32_t)(now - t->expiry) : 0;
+
+            hrtimer_heap_remove(t);
+            if (t->period) {
+                /* Stay on the original grid; skip periods that are already gone */
+                t->expiry += t->period;
+                while (t->expiry <= now) {
+                    t->expiry += t->period;
+                    t->overruns++;
+                }
+                hrtimer_heap_insert(t);
+            }
+
+            if (late > hrtimer_stats.late_max_us) {
+                hrtimer_stats.late_max_us = late;
+            }
+            hrtimer_stats.expiries++;
+
+            if (t->flags & HRTIMER_DEFERRED) {
+                if (xTimerPendFunctionCallFromISR(hrtimer_deferred, t, 0, woken) != pdPASS) {
+                    hrtimer_stats.deferred_drops++;
+                }
+            } else {
+                t->callback(t, t->context);
+            }
+        }
+    } while (hrtimer_program());
+}
+
+HOT_FUNC static void hrtimer_irq(void *context) {
+    BaseType_t woken = pdFALSE;
+
+    (void)context;
+
+    SYSTIMER_WRITE(SYSTIMER_CS, SYSTIMER_CS_MATCH(HRTIMER_CHANNEL));
+    hrtimer_run_due(&woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+/* ========== API ========== */
+
+COLD_FUNC void hrtimer_init(void) {
+    SYSTIMER_WRITE(SYSTIMER_CS, SYSTIMER_CS_MATCH(HRTIMER_CHANNEL));
+    bcm2837_irq_register(IRQ_SYSTEM_TIMER_0 + HRTIMER_CHANNEL, hrtimer_irq, NULL);
+    bcm2837_enable_vc_irq(IRQ_SYSTEM_TIMER_0 + HRTIMER_CHANNEL);
+}
+
+void hrtimer_setup(hrtimer_t *timer, hrtimer_callback_t callback, void *context, uint32_t flags) {
+    timer->callback = callback;
+    timer->context = context;
+    timer->flags = flags;
+    timer->expiry = 0;
+    timer->period = 0;
+    timer->heap_index = -1;
+    timer->overruns = 0;
+}
+
+int hrtimer_start_at(hrtimer_t *timer, uint64_t when_us, uint32_t period_us) {
+    int ok;
+
+    uint32_t cpsr = cpu_irq_save();
+    if (timer->heap_index >= 0) {
+        hrtimer_heap_remove(timer);
+    }
+    timer->expiry = when_us;
+    timer->period = (period_us && period_us < HRTIMER_MIN_PERIOD_US) ? HRTIMER_MIN_PERIOD_US : period_us;
+
+    ok = hrtimer_heap_insert(timer);
+    if (ok && hrtimer_heap[0] == timer && hrtimer_program()) {
+        /* Already due - pend the channel so the IRQ runs it */
+        hrtimer_pend();
+    }
+    cpu_irq_restore(cpsr);
+
+    return ok;
+}
+
+int hrtimer_start(hrtimer_t *timer, uint32_t delay_us, uint32_t period_us) {
+    return hrtimer_start_at(timer, hrtimer_now() + delay_us, period_us);
+}
+
+int hrtimer_cancel(hrtimer_t *timer) {
+    int armed = 0;
+
+    uint32_t cpsr = cpu_irq_save();
+    if (timer->heap_index >= 0) {
+        /* The compare stays loaded; a spurious match just finds nothing due */
+        hrtimer_heap_remove(timer);
+        armed = 1;
+    }
+    cpu_irq_restore(cpsr);
+
+    return armed;
+}
+
+void hrtimer_get_stats(hrtimer_stats_t *stats) {
+    uint32_t cpsr = cpu_irq_save();
+    *stats = hrtimer_stats;
+    cpu_irq_restore(cpsr);
+}
@@ -0,0 +1,83 @@
+/*
+ * High-Resolution Timer Service for RPi2 BCM2837
+ *
+ * Microsecond one-shot and periodic timers multiplexed onto system timer
+ * compare channel 3 (channel 1 is the FIQ latency source, 0 and 2 belong
+ * to the GPU). Armed timers sit in a binary min-heap keyed on their 64-bit
+ * expiry; the compare register always holds the earliest one, so the cost
+ * per expiry is O(log n) and there is no periodic interrupt.
+ *
+ * Callbacks run in IRQ context by default (integer-only, FromISR APIs
+ * only). With HRTIMER_DEFERRED they run in the FreeRTOS timer daemon task
+ * instead, via xTimerPendFunctionCallFromISR().
+ */
+
+#ifndef HRTIMER_H
+#define HRTIMER_H
+
+#include <stdint.h>
+
+/* Maximum number of simultaneously armed timers */
+#define HRTIMER_MAX             32
+
+/* Timers due within this many microseconds are run without reprogramming */
+#define HRTIMER_MIN_LEAD_US     2
+
+/* Shortest period accepted; shorter ones are raised to it */
+#define HRTIMER_MIN_PERIOD_US   10
+
+/* hrtimer_t.flags */
+#define HRTIMER_DEFERRED        (1 << 0)   /* Run the callback in the timer daemon task */
+
+typedef struct hrtimer hrtimer_t;
+
+typedef void (*hrtimer_callback_t)(hrtimer_t *timer, void *context);
+
+struct hrtimer {
+    hrtimer_callback_t callback;
+    void *context;
+    uint32_t flags;
+
+    /* Private - managed by the service */
+    uint64_t expiry;                /* System timer count (us) */
+    uint32_t period;                /* 0 for one-shot */
+    int32_t heap_index;             /* -1 when not armed */
+    uint32_t overruns;              /* Periods skipped because the timer ran late */
+};
+
+typedef struct {
+    uint32_t expiries;              /* Callbacks dispatched */
+    uint32_t late_max_us;           /* Worst compare-to-dispatch delay */
+    uint32_t deferred_drops;        /* Timer daemon queue was full */
+    uint32_t heap_full;             /* hrtimer_start() refused - HRTIMER_MAX armed */
+} hrtimer_stats_t;
+
+/* Register the channel 3 handler and enable IRQ_SYSTEM_TIMER_3 */
+void hrtimer_init(void);
+
+/* Set the callback and flags of an unarmed timer - required before first use */
+void hrtimer_setup(hrtimer_t *timer, hrtimer_callback_t callback, void *context, uint32_t flags);
+
+/*
+ * Arm timer to fire delay_us from now, then every period_us (0 = one-shot).
+ * Re-arming an armed timer moves it. Returns 0 if the heap is full.
+ * Safe from tasks and IRQ handlers, including the timer's own callback.
+ */
+int hrtimer_start(hrtimer_t *timer, uint32_t delay_us, uint32_t period_us);
+
+/* As hrtimer_start() with an absolute expiry in system timer counts */
+int hrtimer_start_at(hrtimer_t *timer, uint64_t when_us, uint32_t period_us);
+
+/* Disarm; returns 1 if the timer was armed. A deferred callback already pended still runs */
+int hrtimer_cancel(hrtimer_t *timer);
+
+static inline int hrtimer_armed(const hrtimer_t *timer) {
+    return timer->heap_index >= 0;
+}
+
+/* 64-bit system timer count in microseconds */
+uint64_t hrtimer_now(void);
+
+void hrtimer_get_stats(hrtimer_stats_t *stats);
+
+#endif /* HRTIMER_H */
@@ -0,0 +1,240 @@
+/*
+ * BSC1 I2C Master Driver for RPi2 BCM2837
+ * Transaction queue and FIFO interrupt path
+ */
+
+#include "i2c.h"
+#include "gpio.h"
+#include "bcm2837_irq.h"
+#include "cpu.h"
+#include "mmio.h"
+#include "placement.h"
+#include <stddef.h>
+
+/* BSC1 registers - pass to mmio_read()/mmio_write() */
+#define BSC1_BASE               0x3F804000
+#define BSC_C                   (BSC1_BASE + 0x00)
+#define BSC_S                   (BSC1_BASE + 0x04)
+#define BSC_DLEN                (BSC1_BASE + 0x08)
+#define BSC_A                   (BSC1_BASE + 0x0C)
+#define BSC_FIFO                (BSC1_BASE + 0x10)
+#define BSC_DIV                 (BSC1_BASE + 0x14)
+
+/* C register bits */
+#define BSC_C_READ              (1u << 0)
+#define BSC_C_CLEAR             (3u << 4)   /* Clear FIFO */
+#define BSC_C_ST                (1u << 7)   /* Start transfer (write 1) */
+#define BSC_C_INTD              (1u << 8)   /* Interrupt on DONE */
+#define BSC_C_INTT              (1u << 9)   /* Interrupt on TXW */
+#define BSC_C_INTR              (1u << 10)  /* Interrupt on RXR */
+#define BSC_C_I2CEN             (1u << 15)
+
+/* S register bits */
+#define BSC_S_DONE              (1u << 1)   /* Write 1 to clear */
+#define BSC_S_TXD               (1u << 4)   /* FIFO can accept data */
+#define BSC_S_RXD               (1u << 5)   /* FIFO contains data */
+#define BSC_S_ERR               (1u << 8)   /* NACK - write 1 to clear */
+#define BSC_S_CLKT              (1u << 9)   /* Clock stretch timeout - write 1 to clear */
+
+#define BSC_S_CLEAR_ALL         (BSC_S_DONE | BSC_S_ERR | BSC_S_CLKT)
+
+/* GPIO pins, ALT0 */
+#define I2C_PIN_SDA             2
+#define I2C_PIN_SCL             3
+
+/* Queue: i2c_head is on the bus, records are linked through queue_next */
+static i2c_xfer_t *i2c_head;
+static i2c_xfer_t *i2c_tail;
+
+static inline uint32_t i2c_stamp(void) {
+    return (uint32_t)cpu_cntpct();
+}
+
+/* ========== Phases ========== */
+
+static void i2c_start_write(i2c_xfer_t *x) {
+    x->reading = 0;
+    x->pos = 0;
+
+    mmio_write(BSC_C, BSC_C_I2CEN | BSC_C_CLEAR);
+    mmio_write(BSC_S, BSC_S_CLEAR_ALL);
+    mmio_write(BSC_A, x->addr);
+    mmio_write(BSC_DLEN, x->tx_len);
+
+    /* Prefill so short writes complete on the DONE interrupt alone */
+    while (x->pos < x->tx_len && (mmio_read(BSC_S) & BSC_S_TXD)) {
+        mmio_write(BSC_FIFO, x->tx[x->pos++]);
+    }
+
+    uint32_t c = BSC_C_I2CEN | BSC_C_INTD | BSC_C_ST;
+    if (x->pos < x->tx_len) {
+        c |= BSC_C_INTT;
+    }
+    mmio_write(BSC_C, c);
+}
+
+static void i2c_start_read(i2c_xfer_t *x) {
+    x->reading = 1;
+    x->pos = 0;
+
+    mmio_write(BSC_C, BSC_C_I2CEN | BSC_C_CLEAR);
+    mmio_write(BSC_S, BSC_S_CLEAR_ALL);
+    mmio_write(BSC_A, x->addr);
+    mmio_write(BSC_DLEN, x->rx_len);
+    mmio_write(BSC_C, BSC_C_I2CEN | BSC_C_INTD | BSC_C_INTR | BSC_C_ST | BSC_C_READ);
+}
+
+/* Put x on the bus - IRQs masked. A record with neither phase is an address probe */
+static void i2c_start(i2c_xfer_t *x) {
+    x->t_start = i2c_stamp();
+    if (x->tx_len || !x->rx_len) {
+        i2c_start_write(x);
+    } else {
+        i2c_start_read(x);
+    }
+}
+
+/* ========== Queue ========== */
+
+/* Retire i2c_head and start the next record - IRQ context */
+HOT_FUNC static void i2c_complete(int32_t status, BaseType_t *woken) {
+    i2c_xfer_t *x = i2c_head;
+
+    mmio_write(BSC_C, BSC_C_I2CEN | BSC_C_CLEAR);
+    mmio_write(BSC_S, BSC_S_CLEAR_ALL);
+
+    i2c_head = x->queue_next;
+    if (i2c_head == NULL) {
+        i2c_tail = NULL;
+    }
+
+    x->t_done = i2c_stamp();
+    x->status = status;
+    if (x->done) {
+        x->done(x);
+    }
+    if (x->notify) {
+        vTaskNotifyGiveIndexedFromISR(x->notify, configDRIVER_NOTIFY_INDEX, woken);
+    }
+
+    if (i2c_head) {
+        i2c_start(i2c_head);
+    }
+}
+
+HOT_FUNC static void i2c_irq(void *context) {
+    BaseType_t woken = pdFALSE;
+    i2c_xfer_t *x = i2c_head;
+    uint32_t s = mmio_read(BSC_S);
+
+    (void)context;
+
+    if (x == NULL) {
+        mmio_write(BSC_C, BSC_C_I2CEN | BSC_C_CLEAR);
+        mmio_write(BSC_S, BSC_S_CLEAR_ALL);
+        return;
+    }
+
+    if (s & (BSC_S_ERR | BSC_S_CLKT)) {
+        i2c_complete((s & BSC_S_ERR) ? I2C_XFER_NACK : I2C_XFER_CLOCK_STRETCH, &woken);
+        portYIELD_FROM_ISR(woken);
+        return;
+    }
+
+    if (x->reading) {
+        while (x->pos < x->rx_len && (mmio_read(BSC_S) & BSC_S_RXD)) {
+            x->rx[x->pos++] = (uint8_t)mmio_read(BSC_FIFO);
+        }
+    } else {
+        while (x->pos < x->tx_len && (mmio_read(BSC_S) & BSC_S_TXD)) {
+            mmio_write(BSC_FIFO, x->tx[x->pos++]);
+        }
+        if (x->pos == x->tx_len) {
+            mmio_write(BSC_C, BSC_C_I2CEN | BSC_C_INTD);    /* TXW stays set - stop its interrupt */
+        }
+    }
+
+    if (s & BSC_S_DONE) {
+        mmio_write(BSC_S, BSC_S_DONE);
+        if (!x->reading && x->rx_len) {
+            i2c_start_read(x);
+        } else {
+            i2c_complete(I2C_XFER_OK, &woken);
+        }
+    }
+
+    portYIELD_FROM_ISR(woken);
+}
+
+void i2c_submit(i2c_xfer_t *batch) {
+    if (batch == NULL) {
+        return;
+    }
+
+    uint32_t stamp = i2c_stamp();
+    i2c_xfer_t *last = batch;
+    for (i2c_xfer_t *x = batch; x; x = x->next) {
+        x->status = I2C_XFER_PENDING;
+        x->t_submit = stamp;
+        x->queue_next = x->next;
+        last = x;
+    }
+
+    uint32_t cpsr = cpu_irq_save();
+    if (i2c_tail) {
+        i2c_tail->queue_next = batch;
+        i2c_tail = last;
+    } else {
+        i2c_head = batch;
+        i2c_tail = last;
+        i2c_start(batch);
+    }
+    cpu_irq_restore(cpsr);
+}
+
+int i2c_transfer(i2c_xfer_t *batch, TickType_t timeout) {
+    if (batch == NULL) {
+        return I2C_XFER_OK;
+    }
+
+    i2c_xfer_t *last = batch;
+    while (last->next) {
+        last = last->next;
+    }
+
+    /* The wait borrows last->notify - it may only already name this task */
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    TaskHandle_t caller = last->notify;
+    if (caller != NULL && caller != self) {
+        return I2C_XFER_INVALID;
+    }
+    last->notify = self;
+
+    ulTaskNotifyTakeIndexed(configDRIVER_NOTIFY_INDEX, pdTRUE, 0);    /* Drop a stale give */
+    i2c_submit(batch);
+    if (ulTaskNotifyTakeIndexed(configDRIVER_NOTIFY_INDEX, pdTRUE, timeout) == 0) {
+        return I2C_XFER_TIMEOUT;     /* Still queued - notify stays until it completes */
+    }
+    last->notify = caller;
+
+    for (i2c_xfer_t *x = batch; x; x = x->next) {
+        if (x->status != I2C_XFER_OK) {
+            return x->status;
+        }
+    }
+    return I2C_XFER_OK;
+}
+
+/* ========== Setup ========== */
+
+COLD_FUNC void i2c_init(uint32_t bus_hz) {
+    gpio_set_function(I2C_PIN_SDA, GPIO_FUNC_ALT0);
+    gpio_set_function(I2C_PIN_SCL, GPIO_FUNC_ALT0);
+
+    mmio_write(BSC_C, BSC_C_I2CEN | BSC_C_CLEAR);
+    mmio_write(BSC_S, BSC_S_CLEAR_ALL);
+    mmio_write(BSC_DIV, I2C_CORE_CLOCK_HZ / bus_hz);
+
+    bcm2837_irq_register(IRQ_I2C, i2c_irq, NULL);
+    bcm2837_enable_vc_irq(IRQ_I2C);
+}
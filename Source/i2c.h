@@ -0,0 +1,80 @@
+/*
+ * BSC1 I2C Master Driver for RPi2 BCM2837
+ * SDA1/SCL1 on GPIO 2/3 (1.8 kOhm pull-ups on the board)
+ *
+ * Same queued model as spi.h: i2c_xfer_t records linked through next are
+ * submitted as a batch and run from IRQ_I2C, filling and draining the
+ * 16-byte FIFO on the TXW/RXR/DONE interrupts. The BSC master has no DMA
+ * request line, so there is no DMA path; I2C field devices move a few
+ * bytes per transaction anyway.
+ *
+ * A record with both tx_len and rx_len writes first (register address),
+ * then reads. The controller cannot issue a repeated start on its own, so
+ * the two phases are separated by a STOP - fine for the usual sensor and
+ * port-expander register protocols.
+ */
+
+#ifndef I2C_H
+#define I2C_H
+
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Core clock feeding the BSC divider */
+#define I2C_CORE_CLOCK_HZ       250000000u
+
+/* i2c_xfer_t.status */
+#define I2C_XFER_OK             0
+#define I2C_XFER_PENDING        1
+#define I2C_XFER_NACK           (-1)       /* Address or data not acknowledged */
+#define I2C_XFER_CLOCK_STRETCH  (-2)       /* Slave held SCL past the CLKT timeout */
+#define I2C_XFER_TIMEOUT        (-3)       /* i2c_transfer() gave up waiting */
+#define I2C_XFER_INVALID        (-4)       /* i2c_transfer(): last record notifies another task */
+
+typedef struct i2c_xfer i2c_xfer_t;
+
+/* Completion callback - IRQ context */
+typedef void (*i2c_callback_t)(i2c_xfer_t *xfer);
+
+struct i2c_xfer {
+    i2c_xfer_t *next;               /* Next record in the batch, NULL at the end */
+    uint8_t addr;                   /* 7-bit slave address */
+    const uint8_t *tx;              /* Write phase, skipped if tx_len is 0 */
+    uint16_t tx_len;
+    uint16_t rx_len;                /* Read phase, skipped if rx_len is 0 */
+    uint8_t *rx;
+
+    i2c_callback_t done;            /* Optional, called from IRQ_I2C */
+    void *context;
+    TaskHandle_t notify;            /* Optional, notified on configDRIVER_NOTIFY_INDEX */
+
+    volatile int32_t status;
+    uint32_t t_submit;              /* CNTPCT low words - see i2c_xfer_latency_ticks() */
+    uint32_t t_start;
+    uint32_t t_done;
+
+    /* Driver private */
+    i2c_xfer_t *queue_next;
+    uint16_t pos;
+    uint8_t reading;
+};
+
+/* Route the pins, set the bus clock and register IRQ_I2C */
+void i2c_init(uint32_t bus_hz);
+
+/* Queue a batch behind anything already pending; see spi_submit() */
+void i2c_submit(i2c_xfer_t *batch);
+
+/* Blocking submit, same notify rules; see spi_transfer() */
+int i2c_transfer(i2c_xfer_t *batch, TickType_t timeout);
+
+static inline uint32_t i2c_xfer_latency_ticks(const i2c_xfer_t *xfer) {
+    return xfer->t_done - xfer->t_submit;
+}
+
+static inline uint32_t i2c_xfer_queue_ticks(const i2c_xfer_t *xfer) {
+    return xfer->t_start - xfer->t_submit;
+}
+
+#endif /* I2C_H */
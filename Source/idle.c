@@ -0,0 +1,216 @@
+/*
+ * Idle Subsystem for RPi2 BCM2837
+ * WFI idle, CNTPCT idle accounting and bounded background jobs
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "idle.h"
+#include "cpu.h"
+#include "uart.h"
+#include "placement.h"
+#include <stddef.h>
+
+#define IDLE_BUCKET_TICKS   CPU_CNTPCT_HZ                                       /* 1 s */
+#define IDLE_SLICE_TICKS    ((uint64_t)IDLE_SLICE_US * (CPU_CNTPCT_HZ / 100000) / 10)
+
+/*
+ * Idle and job time per one-second bucket. Updated by the idle task and
+ * read by any task, always with IRQs masked.
+ */
+static struct {
+    uint64_t bucket_start;          /* CNTPCT at the start of the open bucket, 0 before the first */
+    uint32_t bucket_idle;
+    uint32_t bucket_job;
+    uint32_t idle_hist[IDLE_HISTORY_S];
+    uint32_t job_hist[IDLE_HISTORY_S];
+    uint32_t completed;             /* Buckets ever closed; slot = completed % IDLE_HISTORY_S */
+    uint32_t wakeups;
+} idle_acct PERCORE_DATA;
+
+static idle_job_t *idle_jobs;
+static idle_job_t *idle_job_cursor;     /* Next job to run - round-robin */
+
+/* ========== Accounting ========== */
+
+/* Close every bucket that ended before now - IRQs masked */
+static void idle_roll(uint64_t now) {
+    if (idle_acct.bucket_start == 0) {
+        idle_acct.bucket_start = now;
+        return;
+    }
+
+    /* A busy stretch longer than the history only needs the history zeroed */
+    if (now - idle_acct.bucket_start >= (uint64_t)(IDLE_HISTORY_S + 1) * IDLE_BUCKET_TICKS) {
+        uint64_t skip = (now - idle_acct.bucket_start) / IDLE_BUCKET_TICKS - IDLE_HISTORY_S;
+        idle_acct.bucket_start += skip * IDLE_BUCKET_TICKS;
+        idle_acct.completed += (uint32_t)skip;
+    }
+
+    while (now - idle_acct.bucket_start >= IDLE_BUCKET_TICKS) {
+        uint32_t slot = idle_acct.completed % IDLE_HISTORY_S;
+        idle_acct.idle_hist[slot] = idle_acct.bucket_idle;
+        idle_acct.job_hist[slot] = idle_acct.bucket_job;
+        idle_acct.completed++;
+        idle_acct.bucket_idle = 0;
+        idle_acct.bucket_job = 0;
+        idle_acct.bucket_start += IDLE_BUCKET_TICKS;
+    }
+}
+
+/* Credit [from, to) to idle or job time, split at bucket edges - IRQs masked */
+static void idle_account(uint64_t from, uint64_t to, int job) {
+    idle_roll(from);
+    if (from < idle_acct.bucket_start) {
+        from = idle_acct.bucket_start;
+    }
+
+    while (from < to) {
+        uint64_t end = idle_acct.bucket_start + IDLE_BUCKET_TICKS;
+        uint32_t span = (uint32_t)((to < end ? to : end) - from);
+
+        if (job) {
+            idle_acct.bucket_job += span;
+        } else {
+            idle_acct.bucket_idle += span;
+        }
+        from += span;
+        idle_roll(from);
+    }
+}
+
+/* Load per mille and job share over the last seconds complete buckets - IRQs masked */
+static uint32_t idle_window(uint32_t seconds, uint32_t *job_permille) {
+    uint32_t n = idle_acct.completed < seconds ? idle_acct.completed : seconds;
+    uint64_t idle = 0, job = 0;
+
+    if (n == 0) {
+        if (job_permille) {
+            *job_permille = 0;
+        }
+        return 0;
+    }
+
+    for (uint32_t i = 1; i <= n; i++) {
+        uint32_t slot = (idle_acct.completed - i) % IDLE_HISTORY_S;
+        idle += idle_acct.idle_hist[slot];
+        job += idle_acct.job_hist[slot];
+    }
+
+    uint64_t total = (uint64_t)n * IDLE_BUCKET_TICKS;
+    if (job_permille) {
+        *job_permille = (uint32_t)(job * 1000 / total);
+    }
+    return 1000 - (uint32_t)(idle * 1000 / total);
+}
+
+/* ========== Background Jobs ========== */
+
+void idle_job_register(idle_job_t *job) {
+    job->steps = 0;
+    job->step_max_us = 0;
+    job->idle = 0;
+
+    uint32_t cpsr = cpu_irq_save();
+    job->next = idle_jobs;
+    idle_jobs = job;
+    cpu_irq_restore(cpsr);
+}
+
+void idle_job_kick(idle_job_t *job) {
+    job->idle = 0;
+}
+
+/*
+ * Run job steps round-robin until every job is idle or the slice is used.
+ * Returns 1 if any step ran. idle is set before the step so a kick that
+ * lands while it runs is not lost.
+ */
+static int idle_run_jobs(void) {
+    uint64_t start = cpu_cntpct();
+    uint64_t now = start;
+    uint32_t skipped = 0;
+    uint32_t count = 0;
+
+    for (idle_job_t *j = idle_jobs; j; j = j->next) {
+        count++;
+    }
+
+    while (count && skipped < count && now - start < IDLE_SLICE_TICKS) {
+        idle_job_t *job = idle_job_cursor ? idle_job_cursor : idle_jobs;
+        idle_job_cursor = job->next;
+
+        if (job->idle) {
+            skipped++;
+            continue;
+        }
+        skipped = 0;
+
+        job->idle = 1;
+        uint64_t t0 = now;
+        int more = job->step(job->context);
+        now = cpu_cntpct();
+
+        if (more == IDLE_JOB_MORE) {
+            job->idle = 0;
+        }
+        uint32_t us = cpu_cntpct_to_us((uint32_t)(now - t0));
+        if (us > job->step_max_us) {
+            job->step_max_us = us;
+        }
+        job->steps++;
+    }
+
+    if (now == start) {
+        return 0;
+    }
+
+    uint32_t cpsr = cpu_irq_save();
+    idle_account(start, now, 1);
+    cpu_irq_restore(cpsr);
+    return 1;
+}
+
+/* ========== Idle Hook ========== */
+
+void vApplicationIdleHook(void) {
+    if (idle_run_jobs()) {
+        return;
+    }
+
+    /* Masked so the wakeup IRQ runs after the stamp - handler time is busy time */
+    uint32_t cpsr = cpu_irq_save();
+    uint64_t t0 = cpu_cntpct();
+    cpu_wait_for_interrupt();
+    uint64_t t1 = cpu_cntpct();
+
+    idle_account(t0, t1, 0);
+    idle_acct.wakeups++;
+    cpu_irq_restore(cpsr);
+}
+
+/* ========== Reporting ========== */
+
+void idle_get_stats(idle_stats_t *stats) {
+    uint32_t cpsr = cpu_irq_save();
+    idle_roll(cpu_cntpct());
+    stats->load_1s = idle_window(1, NULL);
+    stats->load_10s = idle_window(10, &stats->job_permille);
+    stats->load_60s = idle_window(IDLE_HISTORY_S, NULL);
+    stats->history_s = idle_acct.completed < IDLE_HISTORY_S ? idle_acct.completed : IDLE_HISTORY_S;
+    stats->wakeups = idle_acct.wakeups;
+    cpu_irq_restore(cpsr);
+}
+
+void idle_print_stats(void) {
+    idle_stats_t s;
+    idle_get_stats(&s);
+
+    uart_printf("CPU load: 1s %u.%u%%, 10s %u.%u%%, 60s %u.%u%% (background %u.%u%%, %u s measured)\n",
+                s.load_1s / 10, s.load_1s % 10, s.load_10s / 10, s.load_10s % 10,
+                s.load_60s / 10, s.load_60s % 10, s.job_permille / 10, s.job_permille % 10,
+                s.history_s);
+    for (idle_job_t *j = idle_jobs; j; j = j->next) {
+        uart_printf("  idle job %s: %u steps, worst %u us\n", j->name, j->steps, j->step_max_us);
+    }
+}
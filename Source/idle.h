@@ -0,0 +1,85 @@
+/*
+ * Idle Subsystem for RPi2 BCM2837
+ *
+ * vApplicationIdleHook (idle.c) does two things each time the idle task
+ * runs:
+ *
+ * 1. Runs registered background jobs (memory scrubbing, statistics,
+ *    housekeeping) in bounded slices, round-robin, for at most
+ *    IDLE_SLICE_US per pass. Jobs only ever get CPU time nobody else
+ *    wanted, and a higher-priority task that becomes ready waits at most
+ *    one job step.
+ *
+ * 2. When no job has work, sleeps in WFI with IRQs masked and measures
+ *    the sleep with CNTPCT. The interrupt that wakes the core is taken
+ *    right after, so interrupt handling counts as busy time.
+ *
+ * Sleep time is accumulated into one-second buckets, giving a rolling
+ * CPU load over the last 1, 10 and 60 seconds. Job time counts as busy,
+ * so the load is what the application would see with no background work
+ * deducted - use idle_get_stats() job_permille to split the two.
+ */
+
+#ifndef IDLE_H
+#define IDLE_H
+
+#include <stdint.h>
+
+/* Most time spent in jobs per idle hook call before checking WFI again */
+#define IDLE_SLICE_US           500
+
+/* Longest load window in seconds (one bucket per second) */
+#define IDLE_HISTORY_S          60
+
+/* idle_job_fn_t return values */
+#define IDLE_JOB_DONE           0   /* Nothing left to do for now */
+#define IDLE_JOB_MORE           1   /* More work pending - call again */
+
+typedef struct idle_job idle_job_t;
+
+/*
+ * One bounded step of background work, in the idle task on its
+ * configMINIMAL_STACK_SIZE stack. Must not block. Keep a step well under
+ * IDLE_SLICE_US; step_max_us records the worst.
+ */
+typedef int (*idle_job_fn_t)(void *context);
+
+struct idle_job {
+    const char *name;
+    idle_job_fn_t step;
+    void *context;
+
+    /* Maintained by the idle subsystem */
+    uint32_t steps;
+    uint32_t step_max_us;
+    volatile uint32_t idle;         /* Last step returned IDLE_JOB_DONE, cleared by idle_job_kick() */
+    idle_job_t *next;
+};
+
+typedef struct {
+    uint32_t load_1s;               /* CPU load per mille over the last 1/10/60 complete seconds */
+    uint32_t load_10s;
+    uint32_t load_60s;
+    uint32_t job_permille;          /* Share of the last 10 s spent in background jobs */
+    uint32_t history_s;             /* Complete seconds measured so far (up to IDLE_HISTORY_S) */
+    uint32_t wakeups;               /* WFI exits */
+} idle_stats_t;
+
+/*
+ * Add a background job - job must stay valid for the life of the system.
+ * Set name, step and context first. Safe before and after the scheduler starts.
+ */
+void idle_job_register(idle_job_t *job);
+
+/*
+ * Mark a job as having work again after it returned IDLE_JOB_DONE (e.g. new
+ * data to scrub). Safe from tasks and IRQ handlers.
+ */
+void idle_job_kick(idle_job_t *job);
+
+void idle_get_stats(idle_stats_t *stats);
+
+/* Print the load line and per-job figures on UART0 */
+void idle_print_stats(void);
+
+#endif /* IDLE_H */
@@ -2,11 +2,30 @@
 #include "task.h"
 #include "uart.h"
 #include "bcm2837_irq.h"
+#include "app_tasks.h"
+#include "boot_trace.h"
+#include "gpio.h"
+#include "dma.h"
+#include "spi.h"
+#include "i2c.h"
+#include "hrtimer.h"
+#include "trace.h"
+#include "idle.h"
+#include "mmu.h"
+#include "memstat.h"
+#include "placement.h"
+#include "cpu.h"
 #include <stddef.h>
 #include <stdint.h>
 
 /* UART functions are now in uart.c */
 
+#define PATTERN_SIZE    (1024 * 1024)   /* 1MB */
+
+/* Word written and read back before the heap is first used */
+static uint32_t probe_word;
+#define PROBE_ADDR      (&probe_word)
+
 /* BCM2837 interrupt controller functions */
 extern void bcm2837_irq_init(void);
 extern void bcm2837_enable_vc_irq(uint32_t irq_num);
@@ -28,91 +47,85 @@ void print_hello_message(void) {
     uart_printf("Hello from FreeRTOS!\n");
 }
 
-// Printf replacement using our uart_printf
-int printf(const char *format, ...) {
-    uart_puts(format);
-    return 0;
+void vSetupTickInterrupt(void) {
+    // Simple stub - in a real system this would configure the timer
+    // For now just placeholder
+    uart_puts("vSetupTickInterrupt called - timer stub\r\n");
 }
 
-// Standard C library functions
-void *memcpy(void *dest, const void *src, size_t n) {
-    char *d = (char *)dest;
-    const char *s = (const char *)src;
-    for (size_t i = 0; i < n; i++) {
-        d[i] = s[i];
-    }
-    return dest;
-}
+// Idle-time scrubber: re-reads the painted area against the current pattern
+#define SCRUB_STEP_WORDS    256     /* 1KB per idle step */
 
-void *memset(void *s, int c, size_t n) {
-    char *p = (char *)s;
-    for (size_t i = 0; i < n; i++) {
-        p[i] = c;
-    }
-    return s;
-}
+/*
+ * The painter can preempt a step anywhere. It bumps scrub_gen with IRQs
+ * masked before each repaint; a step snapshots the generation with its
+ * offset and only commits its result if the generation is unchanged.
+ */
+static volatile uint32_t scrub_pattern;    /* 0 while a repaint is in progress */
+static const volatile uint32_t *scrub_area;
+static volatile uint32_t scrub_gen;
+static uint32_t scrub_offset;
+static uint32_t scrub_errors;
 
-void vAssertCalled(unsigned long ulLine, const char * const pcFileName) {
-    uart_puts("\r\n=== DETAILED ASSERT FAILURE DEBUG ===\r\n");
-    uart_puts("ASSERT FAILED at line: ");
-    uart_decimal(ulLine);
-    uart_puts("\r\n");
-    uart_puts("File: ");
-    uart_puts(pcFileName);
-    uart_puts("\r\n");
-    
-    // Provide specific debugging for common assertion locations
-    // Simple check for "port.c" in filename
-    int isPortC = 0;
-    const char *p = pcFileName;
-    while (*p) {
-        if (*p == 'p' && *(p+1) == 'o' && *(p+2) == 'r' && *(p+3) == 't' && *(p+4) == '.') {
-            isPortC = 1;
-            break;
+static int scrub_step(void *context) {
+    const volatile uint32_t *area = scrub_area;
+    uint32_t errors = 0;
+    (void)context;
+
+    uint32_t cpsr = cpu_irq_save();
+    uint32_t gen = scrub_gen;
+    uint32_t pattern = scrub_pattern;
+    uint32_t offset = scrub_offset;
+    cpu_irq_restore(cpsr);
+
+    if (pattern == 0) {
+        return IDLE_JOB_DONE;
+    }
+    for (uint32_t i = 0; i < SCRUB_STEP_WORDS; i++) {
+        if (area[offset + i] != pattern) {
+            errors++;
         }
-        p++;
     }
-    
-    if (isPortC) {
-        uart_puts("\r\n--- PORT.C ASSERTION ANALYSIS ---\r\n");
-        if (ulLine >= 410 && ulLine <= 420) {
-            uart_puts("CPU Mode assertion - checking APSR register\r\n");
-        } else if (ulLine >= 430 && ulLine <= 450) {
-            uart_puts("GIC Binary Point Register assertion\r\n");
-        } else if (ulLine >= 470 && ulLine <= 480) {
-            uart_puts("Critical nesting assertion\r\n");
-        } else if (ulLine >= 490 && ulLine <= 500) {
-            uart_puts("Interrupt nesting assertion\r\n");
+
+    // A repaint that started during this step invalidates it, and has
+    // already reset the offset for the next pass
+    int more = IDLE_JOB_DONE;
+    cpsr = cpu_irq_save();
+    if (scrub_gen == gen) {
+        scrub_errors += errors;
+
+        // One pass per paint - kicked again after the next one
+        offset += SCRUB_STEP_WORDS;
+        if (offset >= PATTERN_SIZE / sizeof(uint32_t)) {
+            offset = 0;
         } else {
-            uart_puts("Other port.c assertion at line ");
-            uart_decimal(ulLine);
-            uart_puts("\r\n");
+            more = IDLE_JOB_MORE;
         }
+        scrub_offset = offset;
     }
-    
-    uart_puts("\r\nSystem will halt here for debugging.\r\n");
-    uart_puts("=====================================\r\n");
-    for (;;);
+    cpu_irq_restore(cpsr);
+    return more;
 }
 
-void vSetupTickInterrupt(void) {
-    // Simple stub - in a real system this would configure the timer
-    // For now just placeholder
-    uart_puts("vSetupTickInterrupt called - timer stub\r\n");
-}
+static idle_job_t scrub_job = { .name = "Scrub", .step = scrub_step };
 
 // Memory pattern painting task
 void vMemoryPatternTask(void *pvParameters) {
     static unsigned int pattern_counter = 0;
     
-    // Define memory region to paint (1MB starting at heap area)
-    volatile uint32_t *memory_base = (volatile uint32_t *)0x42000000;  // Safe area after guest base
-    const size_t memory_size = 1024 * 1024; // 1MB
+    // Memory region to paint - 1MB of heap, cache-line aligned so the DMA
+    // fill can use 128-bit writes
+    uint8_t *area = pvPortMalloc(PATTERN_SIZE + CACHE_LINE_SIZE);
+    configASSERT(area != NULL);
+    volatile uint32_t *memory_base = (volatile uint32_t *)
+        (((uintptr_t)area + CACHE_LINE_SIZE - 1) & ~(uintptr_t)(CACHE_LINE_SIZE - 1));
+    const size_t memory_size = PATTERN_SIZE;
     const size_t word_count = memory_size / sizeof(uint32_t);
+    scrub_area = memory_base;
     
     uart_puts("=== MEMORY PATTERN PAINTING TASK ===\r\n");
-    uart_puts("Memory base: 0x");
-    uart_hex((unsigned int)memory_base);
+    uart_puts("Memory base: ");
+    uart_hex((uint32_t)(uintptr_t)memory_base);
     uart_puts("\r\n");
     uart_puts("Size: ");
     uart_decimal(memory_size);
@@ -147,16 +160,17 @@ void vMemoryPatternTask(void *pvParameters) {
         uart_puts("Painting memory with pattern: 0x");
         uart_puts(pattern_name);
         uart_puts("\r\n");
+        uint32_t cpsr = cpu_irq_save();
+        scrub_gen++;
+        scrub_pattern = 0;
+        scrub_offset = 0;
+        cpu_irq_restore(cpsr);
         
-        // Paint memory with pattern
-        for (size_t i = 0; i < word_count; i++) {
-            memory_base[i] = pattern;
-            
-            // Progress indicator every 64K words
-            if ((i % (16384)) == 0) {
-                uart_puts("Progress: ");
-                uart_decimal((i * 100) / word_count);
-                uart_puts("%\r\n");
+        // Paint memory with pattern - DMA fill mode, this task blocks until done
+        if (dma_fill32((void *)memory_base, pattern, memory_size) != DMA_OP_OK) {
+            uart_puts("DMA fill failed, painting with CPU\r\n");
+            for (size_t i = 0; i < word_count; i++) {
+                memory_base[i] = pattern;
             }
         }
         
@@ -170,11 +184,15 @@ void vMemoryPatternTask(void *pvParameters) {
             size_t offset = j * (word_count / 5);
             uart_puts("  [");
             uart_decimal(offset);
-            uart_puts("]: 0x");
+            uart_puts("]: ");
             uart_hex(memory_base[offset]);
             uart_puts("\r\n");
         }
         
+        scrub_pattern = pattern;
+        idle_job_kick(&scrub_job);
+        uart_printf("Scrubber: %u words mismatched so far\n", scrub_errors);
+
         pattern_counter++;
         
         // Wait longer to allow memory dump
@@ -194,6 +212,7 @@ void vPLCMain(void *pvParameters) {
         // Simple counter display (0-9)
         uart_putc('0' + (counter % 10));
         uart_puts("\r\n");
+        idle_print_stats();
         
         counter++;
         vTaskDelay(pdMS_TO_TICKS(5000));  // 5 second delay (longer to not interfere)
@@ -208,19 +227,60 @@ void vDemoTask(void *pvParameters) {
     }
 }
 
+// Stack depths - a memstat report (memstat.h) overrides them via MEMSTAT_SIZES
+#ifndef MEMSTAT_STACK_vMemoryPatternTask
+#define MEMSTAT_STACK_vMemoryPatternTask    (configMINIMAL_STACK_SIZE * 4)
+#endif
+#ifndef MEMSTAT_STACK_vPLCMain
+#define MEMSTAT_STACK_vPLCMain              (configMINIMAL_STACK_SIZE * 2)
+#endif
+#ifndef MEMSTAT_STACK_vDemoTask
+#define MEMSTAT_STACK_vDemoTask             configMINIMAL_STACK_SIZE
+#endif
+
+// Boot-time task table - TCBs and stacks are statically allocated
+APP_TASK(vMemoryPatternTask, "MemPattern", MEMSTAT_STACK_vMemoryPatternTask, 3, 0);
+APP_TASK(vPLCMain, "PLC", MEMSTAT_STACK_vPLCMain, 2, 0);
+APP_TASK(vDemoTask, "Demo", MEMSTAT_STACK_vDemoTask, 1, 0);
+
 int main(void) {
     // CRITICAL: Initialize UART first before any output!
     uart_init();
 
     uart_puts("=== MAIN() ENTRY POINT ===\r\n");
 
+    // Flight recorder - dumps the previous boot's ring if it faulted
+    trace_init();
+
+#ifndef HOST_SIM
+    // Flat memory map with guard pages below the static task stacks
+    mmu_init();
+#endif
+
     // Initialize BCM2837 interrupt controllers
     uart_puts("Initializing BCM2837 interrupt controllers...\r\n");
     bcm2837_irq_init();
     uart_puts("Interrupt controllers initialized.\r\n");
 
-    // Enable UART interrupt (IRQ 57) if needed for UART RX
-    // bcm2837_enable_vc_irq(IRQ_UART);
+    // GPIO bank interrupts for edge capture (edges are enabled per pin)
+    gpio_init();
+
+    // Field I/O buses - remote I/O modules on SPI0, sensors on I2C1
+    dma_init();
+    spi_init();
+    i2c_init(100000);
+
+    // Microsecond timers on system timer compare 3
+    hrtimer_init();
+
+    // Background work for the idle task (WFI when it has none)
+    idle_job_register(&scrub_job);
+
+    // Stack high-water and heap telemetry for right-sizing (memstat.h)
+    memstat_init();
+
+    // UART receive interrupt (IRQ 57) is enabled by the diagnostics
+    // shell task when it starts (shell.h, console.h)
 
     print_freertos_starting();
     
@@ -228,11 +288,11 @@ int main(void) {
     uart_puts("Initializing FreeRTOS on seL4...\r\n");
     uart_puts("Creating tasks...\r\n");
     
-    uart_puts("vPLCMain function address: 0x");
-    uart_hex((unsigned int)vPLCMain);
+    uart_puts("vPLCMain function address: ");
+    uart_hex((uint32_t)(uintptr_t)vPLCMain);
     uart_puts("\r\n");
-    uart_puts("vDemoTask function address: 0x");
-    uart_hex((unsigned int)vDemoTask);
+    uart_puts("vDemoTask function address: ");
+    uart_hex((uint32_t)(uintptr_t)vDemoTask);
     uart_puts("\r\n");
     
     // Check initial heap status
@@ -244,10 +304,10 @@ int main(void) {
     
     // Test basic memory access before trying FreeRTOS heap
     uart_puts("Testing basic memory access...\r\n");
-    volatile uint32_t *test_addr = (volatile uint32_t *)0x4001D000;  // Should be in BSS area
+    volatile uint32_t *test_addr = (volatile uint32_t *)PROBE_ADDR;
     *test_addr = 0x12345678;
     uint32_t read_val = *test_addr;
-    uart_puts("Memory test: wrote 0x12345678, read 0x");
+    uart_puts("Memory test: wrote 0x12345678, read ");
     uart_hex(read_val);
     uart_puts("\r\n");
     
@@ -259,8 +319,8 @@ int main(void) {
         void *test_ptr = pvPortMalloc(100);
         uart_puts("Test allocation (100 bytes): ");
         if (test_ptr) {
-            uart_puts("SUCCESS at 0x");
-            uart_hex((unsigned int)test_ptr);
+            uart_puts("SUCCESS at ");
+            uart_hex((uint32_t)(uintptr_t)test_ptr);
             uart_puts("\r\n");
             // Note: heap_1 doesn't support freeing memory
             uart_puts("Note: Using heap_1 - memory cannot be freed\r\n");
@@ -278,62 +338,21 @@ int main(void) {
     uart_decimal(xPortGetMinimumEverFreeHeapSize());
     uart_puts(" bytes\r\n");
     
-    uart_puts("Stack sizes requested:\r\n");
-    uart_puts("  MemPattern: ");
-    uart_decimal(configMINIMAL_STACK_SIZE * 4 * sizeof(StackType_t));
-    uart_puts(" bytes\r\n");
-    uart_puts("  PLC: ");
-    uart_decimal(configMINIMAL_STACK_SIZE * 2 * sizeof(StackType_t));
-    uart_puts(" bytes\r\n");
-    uart_puts("  Demo: ");
-    uart_decimal(configMINIMAL_STACK_SIZE * sizeof(StackType_t));
-    uart_puts(" bytes\r\n");
-    
-    // Create multiple tasks like a real system
-    uart_puts("=== CREATING MEMORY PATTERN TASK ===\r\n");
-    uart_puts("About to call xTaskCreate for MemPattern...\r\n");
-    BaseType_t result1 = xTaskCreate(vMemoryPatternTask, "MemPattern", configMINIMAL_STACK_SIZE * 4, NULL, 3, NULL);
-    uart_puts("xTaskCreate returned!\r\n");
-    uart_puts("Memory Pattern task creation result: ");
-    uart_decimal(result1);
-    if (result1 == pdPASS) {
-        uart_puts(" (SUCCESS)\r\n");
-    } else {
-        uart_puts(" (FAILED - insufficient heap memory)\r\n");
-    }
-    uart_puts("Free heap after task 1: ");
-    uart_decimal(xPortGetFreeHeapSize());
-    uart_puts(" bytes\r\n");
-    
-    uart_puts("=== CREATING PLC TASK ===\r\n");
-    BaseType_t result2 = xTaskCreate(vPLCMain, "PLC", configMINIMAL_STACK_SIZE * 2, NULL, 2, NULL);
-    uart_puts("PLC task creation result: ");
-    uart_decimal(result2);
-    if (result2 == pdPASS) {
-        uart_puts(" (SUCCESS)\r\n");
-    } else {
-        uart_puts(" (FAILED - insufficient heap memory)\r\n");
-    }
-    uart_puts("Free heap after task 2: ");
-    uart_decimal(xPortGetFreeHeapSize());
-    uart_puts(" bytes\r\n");
-    
-    uart_puts("=== CREATING DEMO TASK ===\r\n");
-    BaseType_t result3 = xTaskCreate(vDemoTask, "Demo", configMINIMAL_STACK_SIZE, NULL, 1, NULL);
-    uart_puts("Demo task creation result: ");
-    uart_decimal(result3);
-    if (result3 == pdPASS) {
-        uart_puts(" (SUCCESS)\r\n");
-    } else {
-        uart_puts(" (FAILED - insufficient heap memory)\r\n");
-    }
-    uart_puts("Free heap after task 3: ");
+    // Create the boot task table (static TCBs and stacks, no heap use)
+    uart_puts("=== CREATING STATIC TASKS ===\r\n");
+    unsigned int created = app_tasks_create_all();
+    uart_puts("Static tasks created: ");
+    uart_decimal(created);
+    uart_puts("\r\n");
+    app_tasks_print_map();
+    uart_puts("Free heap after task creation: ");
     uart_decimal(xPortGetFreeHeapSize());
     uart_puts(" bytes\r\n");
     
     uart_puts("Starting FreeRTOS scheduler...\r\n");
     uart_puts("Tasks will begin running momentarily...\r\n");
     
+    boot_trace_mark(BOOT_PHASE_SCHEDULER);
     vTaskStartScheduler();
     
     // This should never be reached
@@ -343,15 +362,3 @@ int main(void) {
         uart_puts("System halted.\r\n");
     };
 }
-
-// Required idle hook function for FreeRTOS
-void vApplicationIdleHook(void) {
-    static uint32_t idle_counter = 0;
-    
-    // Simple heartbeat every ~1 million idle cycles
-    if ((idle_counter & 0xFFFFF) == 0) {
-        uart_puts(".");  // Minimal heartbeat
-    }
-    idle_counter++;
-}
-
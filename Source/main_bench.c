@@ -0,0 +1,50 @@
+/*
+ * Benchmark image - runs the bench.c suite from a single FreeRTOS task.
+ * Build with ./build_bench.sh, results are printed on UART0.
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "uart.h"
+#include "bench.h"
+#include "boot_trace.h"
+#include "dma.h"
+#include "spi.h"
+#include "hrtimer.h"
+#include "trace.h"
+#include "mmu.h"
+
+extern void bcm2837_irq_init(void);
+
+static void vBenchTask(void *pvParameters) {
+    (void)pvParameters;
+
+    bench_run_all();
+
+    uart_puts("=== BENCHMARKS COMPLETE ===\r\n");
+    for (;;) {
+        vTaskDelay(portMAX_DELAY);
+    }
+}
+
+int main(void) {
+    uart_init();
+
+    uart_puts("=== BENCHMARK IMAGE ===\r\n");
+    trace_init();
+    mmu_init();     /* Same memory attributes as the application image */
+    bcm2837_irq_init();
+    dma_init();
+    spi_init();
+    hrtimer_init();
+
+    if (xTaskCreate(vBenchTask, "Bench", configMINIMAL_STACK_SIZE * 4, NULL, 1, NULL) != pdPASS) {
+        uart_puts("Bench task creation FAILED\r\n");
+    }
+
+    boot_trace_mark(BOOT_PHASE_SCHEDULER);
+    vTaskStartScheduler();
+
+    uart_puts("CRITICAL ERROR: Scheduler returned unexpectedly!\r\n");
+    for (;;);
+}
@@ -0,0 +1,275 @@
+/*
+ * Stack and Heap Sizing Telemetry for RPi2 BCM2837
+ * Allocation histogram, high-water mark sampling and the sizing report
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include "semphr.h"
+#include "memstat.h"
+#include "app_tasks.h"
+#include "console.h"
+#include "cpu.h"
+#include <stddef.h>
+
+/* ========== Heap Hooks ========== */
+
+/* Updated inside pvPortMalloc/vPortFree, read with IRQs masked */
+static struct {
+    uint32_t hist[MEMSTAT_HIST_BUCKETS];
+    uint32_t mallocs;
+    uint32_t failures;
+    uint32_t frees;
+    uint32_t largest;           /* Largest block asked for, header included */
+} memstat_heap;
+
+static unsigned int memstat_bucket(size_t size) {
+    if (size <= 16) {
+        return 0;
+    }
+    unsigned int b = 32 - __builtin_clz((uint32_t)size - 1) - 4;
+    return b < MEMSTAT_HIST_BUCKETS ? b : MEMSTAT_HIST_BUCKETS - 1;
+}
+
+void memstat_malloc(void *block, size_t size) {
+    uint32_t cpsr = cpu_irq_save();
+    memstat_heap.hist[memstat_bucket(size)]++;
+    if (block) {
+        memstat_heap.mallocs++;
+    } else {
+        memstat_heap.failures++;
+    }
+    if (size > memstat_heap.largest) {
+        memstat_heap.largest = (uint32_t)size;
+    }
+    cpu_irq_restore(cpsr);
+}
+
+void memstat_free(void *block, size_t size) {
+    (void)block;
+    (void)size;
+    uint32_t cpsr = cpu_irq_save();
+    memstat_heap.frees++;
+    cpu_irq_restore(cpsr);
+}
+
+/* ========== Sampling ========== */
+
+/* Per task, matched by task number; guarded by memstat_lock */
+static struct {
+    UBaseType_t number;
+    char name[configMAX_TASK_NAME_LEN];
+    const char *symbol;         /* APP_TASK function, NULL for kernel/heap tasks */
+    uint32_t depth;             /* Words, 0 if unknown */
+    uint32_t min_free;          /* Words never touched, lowest seen */
+} memstat_tasks[MEMSTAT_MAX_TASKS];
+static uint32_t memstat_task_count;
+
+static TaskStatus_t memstat_status[MEMSTAT_MAX_TASKS];
+static uint32_t memstat_samples;
+static uint32_t memstat_frag_worst;     /* Per mille */
+
+static SemaphoreHandle_t memstat_lock;
+static StaticSemaphore_t memstat_lock_buffer;
+
+/* Stack depth of a task this image created, 0 for xTaskCreate tasks */
+static uint32_t memstat_depth(TaskHandle_t handle, const char **symbol) {
+    const app_task_t *t = app_tasks_find(handle);
+
+    *symbol = NULL;
+    if (t) {
+        *symbol = t->symbol;
+        return t->stack_depth;
+    }
+    if (handle == xTaskGetIdleTaskHandle()) {
+        *symbol = "IDLE";
+        return IDLE_TASK_STACK_DEPTH;
+    }
+    if (handle == xTimerGetTimerDaemonTaskHandle()) {
+        *symbol = "TIMER";
+        return configTIMER_TASK_STACK_DEPTH;
+    }
+    return 0;
+}
+
+static void memstat_record(const TaskStatus_t *ts) {
+    uint32_t i;
+
+    for (i = 0; i < memstat_task_count; i++) {
+        if (memstat_tasks[i].number == ts->xTaskNumber) {
+            break;
+        }
+    }
+    if (i == memstat_task_count) {
+        if (memstat_task_count == MEMSTAT_MAX_TASKS) {
+            return;
+        }
+        memstat_task_count++;
+        memstat_tasks[i].number = ts->xTaskNumber;
+        for (uint32_t c = 0; c < configMAX_TASK_NAME_LEN; c++) {
+            memstat_tasks[i].name[c] = ts->pcTaskName[c];
+            if (ts->pcTaskName[c] == '\0') {
+                break;
+            }
+        }
+        memstat_tasks[i].name[configMAX_TASK_NAME_LEN - 1] = '\0';
+        memstat_tasks[i].depth = memstat_depth(ts->xHandle, &memstat_tasks[i].symbol);
+        memstat_tasks[i].min_free = ts->usStackHighWaterMark;
+    }
+
+    if (ts->usStackHighWaterMark < memstat_tasks[i].min_free) {
+        memstat_tasks[i].min_free = ts->usStackHighWaterMark;
+    }
+}
+
+void memstat_init(void) {
+    memstat_lock = xSemaphoreCreateMutexStatic(&memstat_lock_buffer);
+}
+
+void memstat_sample(void) {
+    HeapStats_t hs;
+
+    xSemaphoreTake(memstat_lock, portMAX_DELAY);
+
+    UBaseType_t n = uxTaskGetSystemState(memstat_status, MEMSTAT_MAX_TASKS, NULL);
+    for (UBaseType_t i = 0; i < n; i++) {
+        memstat_record(&memstat_status[i]);
+    }
+
+    vPortGetHeapStats(&hs);
+    if (hs.xAvailableHeapSpaceInBytes) {
+        uint32_t frag = 1000 - (uint32_t)((uint64_t)hs.xSizeOfLargestFreeBlockInBytes * 1000 /
+                                          hs.xAvailableHeapSpaceInBytes);
+        if (frag > memstat_frag_worst) {
+            memstat_frag_worst = frag;
+        }
+    }
+    memstat_samples++;
+
+    xSemaphoreGive(memstat_lock);
+}
+
+/* ========== Report ========== */
+
+/* RAM an APP_TASK_STACK() of this depth occupies, guard page included */
+static uint32_t memstat_footprint(uint32_t words) {
+    uint32_t bytes = APP_TASK_GUARD_SIZE + words * (uint32_t)sizeof(StackType_t);
+    return (bytes + APP_TASK_STACK_ALIGN - 1) & ~(uint32_t)(APP_TASK_STACK_ALIGN - 1);
+}
+
+/* Peak + margin, then grown to the largest depth with the same footprint */
+static uint32_t memstat_recommend(uint32_t used) {
+    uint32_t need = used + used * MEMSTAT_STACK_MARGIN_PCT / 100 + MEMSTAT_STACK_SLACK_WORDS;
+    return (memstat_footprint(need) - APP_TASK_GUARD_SIZE) / (uint32_t)sizeof(StackType_t);
+}
+
+void memstat_report(void) {
+    HeapStats_t hs;
+    uint32_t cpsr;
+    uint32_t reclaim = 0;
+
+    xSemaphoreTake(memstat_lock, portMAX_DELAY);
+
+    cpsr = cpu_irq_save();
+    uint32_t mallocs = memstat_heap.mallocs;
+    uint32_t failures = memstat_heap.failures;
+    uint32_t frees = memstat_heap.frees;
+    uint32_t largest = memstat_heap.largest;
+    cpu_irq_restore(cpsr);
+
+    vPortGetHeapStats(&hs);
+    uint32_t heap_peak = (uint32_t)(configTOTAL_HEAP_SIZE - hs.xMinimumEverFreeBytesRemaining);
+    uint32_t heap_rec = heap_peak + heap_peak * MEMSTAT_HEAP_MARGIN_PCT / 100;
+    heap_rec = (heap_rec + MEMSTAT_HEAP_ROUND - 1) & ~(uint32_t)(MEMSTAT_HEAP_ROUND - 1);
+
+    console_printf("=== memstat: %u samples, %u s ===\n", memstat_samples,
+                   memstat_samples * MEMSTAT_SAMPLE_MS / 1000);
+    console_printf("Heap: peak %u of %u bytes, worst fragmentation %u.%u%%\n",
+                   heap_peak, (uint32_t)configTOTAL_HEAP_SIZE,
+                   memstat_frag_worst / 10, memstat_frag_worst % 10);
+    console_printf("  %u allocations, %u frees, %u failed, largest block %u\n",
+                   mallocs, frees, failures, largest);
+    for (unsigned int b = 0; b < MEMSTAT_HIST_BUCKETS; b++) {
+        cpsr = cpu_irq_save();
+        uint32_t count = memstat_heap.hist[b];
+        cpu_irq_restore(cpsr);
+        if (count == 0) {
+            continue;
+        }
+        if (b < MEMSTAT_HIST_BUCKETS - 1) {
+            console_printf("  <= %u: %u\n", 16u << b, count);
+        } else {
+            console_printf("  >  %u: %u\n", 16u << (b - 1), count);
+        }
+    }
+
+    console_puts("Stacks (words): depth, peak used, recommended\n");
+    for (uint32_t i = 0; i < memstat_task_count; i++) {
+        uint32_t depth = memstat_tasks[i].depth;
+        if (depth == 0) {
+            console_printf("  %s: not a static task, %u words never used\n",
+                           memstat_tasks[i].name, memstat_tasks[i].min_free);
+            continue;
+        }
+        uint32_t used = depth - memstat_tasks[i].min_free;
+        uint32_t rec = memstat_recommend(used);
+        uint32_t now = memstat_footprint(depth);
+        uint32_t then = memstat_footprint(rec);
+        console_printf("  %s: %u, %u, %u", memstat_tasks[i].name, depth, used, rec);
+        if (then < now) {
+            console_printf(" (frees %u bytes)\n", now - then);
+            reclaim += now - then;
+        } else if (then > now) {
+            console_printf(" (needs %u more bytes)\n", then - now);
+        } else {
+            console_puts("\n");
+        }
+    }
+    if (heap_rec < configTOTAL_HEAP_SIZE) {
+        console_printf("Reclaimable: %u bytes of stack, %u bytes of heap\n",
+                       reclaim, (uint32_t)configTOTAL_HEAP_SIZE - heap_rec);
+    } else {
+        console_printf("Reclaimable: %u bytes of stack, heap needs %u more bytes\n",
+                       reclaim, heap_rec - (uint32_t)configTOTAL_HEAP_SIZE);
+    }
+
+    /* Build input - tools/memstat_sizes.py, MEMSTAT_SIZES=<file> ./build_rpi2.sh */
+    console_puts("--- memstat_sizes.h ---\n");
+    console_printf("#define MEMSTAT_HEAP_SIZE %u\n", heap_rec);
+    for (uint32_t i = 0; i < memstat_task_count; i++) {
+        if (memstat_tasks[i].symbol) {
+            uint32_t used = memstat_tasks[i].depth - memstat_tasks[i].min_free;
+            console_printf("#define MEMSTAT_STACK_%s %u\n",
+                           memstat_tasks[i].symbol, memstat_recommend(used));
+        }
+    }
+    console_puts("--- end memstat_sizes.h ---\n");
+
+    xSemaphoreGive(memstat_lock);
+}
+
+/* ========== Task ========== */
+
+#define MEMSTAT_TASK_PRIORITY   ( tskIDLE_PRIORITY + 1 )
+
+#ifndef MEMSTAT_STACK_vMemstatTask
+#define MEMSTAT_STACK_vMemstatTask      configMINIMAL_STACK_SIZE
+#endif
+
+void vMemstatTask(void *pvParameters) {
+    TickType_t last = xTaskGetTickCount();
+    uint32_t reported = 0;
+
+    (void)pvParameters;
+    for (;;) {
+        memstat_sample();
+        if (!reported && memstat_samples * MEMSTAT_SAMPLE_MS >= MEMSTAT_SOAK_S * 1000u) {
+            memstat_report();
+            reported = 1;
+        }
+        vTaskDelayUntil(&last, pdMS_TO_TICKS(MEMSTAT_SAMPLE_MS));
+    }
+}
+
+APP_TASK(vMemstatTask, "Memstat", MEMSTAT_STACK_vMemstatTask, MEMSTAT_TASK_PRIORITY, 0);
@@ -0,0 +1,90 @@
+/*
+ * Stack and Heap Sizing Telemetry for RPi2 BCM2837
+ *
+ * Measures what the tasks and the FreeRTOS heap actually use over a soak
+ * run, so stack depths and configTOTAL_HEAP_SIZE can be cut to fit:
+ *
+ *   - every pvPortMalloc() (traceMALLOC) lands in a power-of-two size
+ *     histogram, failures are counted, frees (traceFREE) too
+ *   - the memstat task samples every MEMSTAT_SAMPLE_MS: each task's stack
+ *     high-water mark (kept per task, so deleted tasks are not forgotten)
+ *     and heap fragmentation, keeping the worst seen
+ *   - after MEMSTAT_SOAK_S it prints memstat_report() once; the shell's
+ *     sizes command prints it on demand
+ *
+ * The report ends with a block of #defines between the markers
+ *
+ *   --- memstat_sizes.h ---
+ *   --- end memstat_sizes.h ---
+ *
+ * tools/memstat_sizes.py cuts it out of a UART capture, and
+ * MEMSTAT_SIZES=<file> ./build_rpi2.sh force-includes it:
+ *
+ *   MEMSTAT_HEAP_SIZE             configTOTAL_HEAP_SIZE (FreeRTOSConfig.h);
+ *                                 also drops the shell bench command, whose
+ *                                 heap buffers the soak never saw
+ *   MEMSTAT_STACK_IDLE            idle task stack (rpi2_support.c)
+ *   MEMSTAT_STACK_TIMER           configTIMER_TASK_STACK_DEPTH
+ *   MEMSTAT_STACK_<function>      the depth of APP_TASK(<function>, ...)
+ *
+ * Recommended depth = peak use + MEMSTAT_STACK_MARGIN_PCT +
+ * MEMSTAT_STACK_SLACK_WORDS, then grown to fill the RAM the stack takes
+ * anyway: with guard pages (mmu.h) every APP_TASK_STACK() occupies whole
+ * pages, so only a cut across a page boundary gives memory back - the
+ * report shows the bytes each change actually reclaims. A high-water
+ * mark only covers the paths the soak exercised; soak with the real
+ * field I/O and fault handling running.
+ *
+ * Host builds (build_host.sh) collect the same figures, but their stacks
+ * are sized for the POSIX port - never feed a host report into the
+ * target build.
+ *
+ * Set configUSE_MEMSTAT to 0 in FreeRTOSConfig.h to drop the heap hooks.
+ */
+
+#ifndef MEMSTAT_H
+#define MEMSTAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Sampling period and soak length before the automatic report */
+#define MEMSTAT_SAMPLE_MS           1000
+#define MEMSTAT_SOAK_S              600
+
+/* Tasks whose high-water marks are remembered */
+#define MEMSTAT_MAX_TASKS           24
+
+/* Allocation size classes: <=16, <=32, ... <=64K, larger */
+#define MEMSTAT_HIST_BUCKETS        14
+
+/* Headroom on top of the measured peak */
+#define MEMSTAT_STACK_MARGIN_PCT    25
+#define MEMSTAT_STACK_SLACK_WORDS   80      /* A full VFP context (fpu.h) plus a little */
+#define MEMSTAT_HEAP_MARGIN_PCT     25
+#define MEMSTAT_HEAP_ROUND          4096
+
+/* traceMALLOC / traceFREE - called with the scheduler suspended */
+void memstat_malloc(void *block, size_t size);
+void memstat_free(void *block, size_t size);
+
+/* Create the report lock - in main(), before the scheduler starts */
+void memstat_init(void);
+
+/* Take one stack/heap sample now (the memstat task does this periodically) */
+void memstat_sample(void);
+
+/* Print the summary and the memstat_sizes.h block on the console */
+void memstat_report(void);
+
+/* The sampling task - created by app_tasks_create_all() */
+void vMemstatTask(void *pvParameters);
+
+/* ========== FreeRTOS Hooks ========== */
+
+#if configUSE_MEMSTAT
+#define traceMALLOC(pvAddress, uiSize)      memstat_malloc((pvAddress), (uiSize))
+#define traceFREE(pvAddress, uiSize)        memstat_free((pvAddress), (uiSize))
+#endif
+
+#endif /* MEMSTAT_H */
@@ -0,0 +1,151 @@
+/*
+ * Peripheral Register Access for RPi2 BCM2837
+ *
+ * Every accessor is a static inline single volatile load or store, so
+ * the generated code is the same as a raw *(volatile uint32_t *) macro.
+ * Fields are mmio_field_t constants, folded at compile time into masks
+ * and shifts:
+ *
+ *     #define UART_IBRD_DIVISOR   MMIO_FIELD(0, 16)
+ *     mmio_write(UART0_BASE + UART0_IBRD, MMIO_PREP(UART_IBRD_DIVISOR, 26));
+ *     mmio_write_field(GPIO_BASE + GPFSEL(1), 21, 3, GPIO_FUNC_ALT0);
+ *
+ * A field is a struct, so it only works through MMIO_GET/MMIO_PREP/
+ * MMIO_MASK - "reg & UART_DR_DATA" does not compile - and MMIO_FIELD()
+ * rejects a field that does not fit in 32 bits at build time.
+ *
+ * mmio_modify() is the one read-modify-write primitive: one load, one
+ * store, and the caller decides what is held across it (normally
+ * cpu_irq_save()).
+ *
+ * Ordering (BCM2835 ARM Peripherals, section 1.3): the VideoCore AXI bus
+ * keeps accesses to one peripheral in order, but reads from two different
+ * peripherals may return out of order. Switching peripherals needs a dmb
+ * after the last read of the old one and before the first write to the
+ * new one - mmio_barrier(). Accesses within one peripheral need none. The
+ * IRQ dispatcher in rpi2_support.c places the barrier around every
+ * peripheral handler, so a handler that only touches its own peripheral
+ * needs none of its own.
+ *
+ * HOST_SIM builds route every access to the mock register file in
+ * Source/host/mmio_mock.c (see the bottom of this file).
+ */
+
+#ifndef MMIO_H
+#define MMIO_H
+
+#include <stdint.h>
+
+/* ========== Fields ========== */
+
+typedef struct {
+    uint32_t shift;
+    uint32_t width;
+} mmio_field_t;
+
+/* Field of width bits at shift - 1 <= width, shift + width <= 32, checked at build time */
+#define MMIO_FIELD(shift, width) \
+    ((mmio_field_t){ (shift) + 0 * sizeof(struct { \
+        _Static_assert((width) >= 1 && (shift) + (width) <= 32, "MMIO field outside 32 bits"); \
+        int ok; }), (width) })
+
+static inline uint32_t mmio_field_mask(mmio_field_t field) {
+    return (0xFFFFFFFFu >> (32 - field.width)) << field.shift;
+}
+
+/* Mask of a field, in place */
+#define MMIO_MASK(field)            mmio_field_mask(field)
+
+/* Extract a field from a register value */
+static inline uint32_t mmio_field_get(mmio_field_t field, uint32_t reg) {
+    return (reg & mmio_field_mask(field)) >> field.shift;
+}
+#define MMIO_GET(field, reg)        mmio_field_get((field), (uint32_t)(reg))
+
+/* Position a field value for a register write (excess bits dropped) */
+static inline uint32_t mmio_field_prep(mmio_field_t field, uint32_t value) {
+    return (value << field.shift) & mmio_field_mask(field);
+}
+#define MMIO_PREP(field, value)     mmio_field_prep((field), (uint32_t)(value))
+
+/* ========== Barriers ========== */
+
+#ifndef HOST_SIM
+
+/* Peripheral switch - see the ordering note above */
+static inline void mmio_barrier(void) {
+    __asm volatile("dmb" ::: "memory");
+}
+
+/* Normal memory the peripheral will read (DMA control blocks) must be complete first */
+static inline void mmio_dsb(void) {
+    __asm volatile("dsb" ::: "memory");
+}
+
+/* ========== Accessors ========== */
+
+static inline uint32_t mmio_read(uintptr_t addr) {
+    return *(volatile uint32_t *)addr;
+}
+
+static inline void mmio_write(uintptr_t addr, uint32_t value) {
+    *(volatile uint32_t *)addr = value;
+}
+
+#else /* HOST_SIM */
+
+/* ========== Host Mock Backend (Source/host/mmio_mock.c) ========== */
+
+/* Side effects for an address range - return the value reads see / writes store */
+typedef uint32_t (*mmio_mock_read_t)(uintptr_t addr, uint32_t stored, void *context);
+typedef uint32_t (*mmio_mock_write_t)(uintptr_t addr, uint32_t stored, uint32_t value, void *context);
+
+uint32_t mmio_mock_read(uintptr_t addr);
+void mmio_mock_write(uintptr_t addr, uint32_t value);
+
+/* Attach handlers to [base, base + size); either may be NULL for plain storage */
+int mmio_mock_hook(uintptr_t base, uint32_t size, mmio_mock_read_t read, mmio_mock_write_t write,
+                   void *context);
+
+/* Backing store access without side effects or counting */
+uint32_t mmio_mock_peek(uintptr_t addr);
+void mmio_mock_poke(uintptr_t addr, uint32_t value);
+
+/* Accesses made through mmio_read/mmio_write since the last reset */
+void mmio_mock_counts(uint32_t *reads, uint32_t *writes, uint32_t *barriers);
+
+/* Drop all registers, hooks and counts */
+void mmio_mock_reset(void);
+
+void mmio_mock_barrier(void);
+
+static inline void mmio_barrier(void) {
+    mmio_mock_barrier();
+}
+
+static inline void mmio_dsb(void) {
+    mmio_mock_barrier();
+}
+
+static inline uint32_t mmio_read(uintptr_t addr) {
+    return mmio_mock_read(addr);
+}
+
+static inline void mmio_write(uintptr_t addr, uint32_t value) {
+    mmio_mock_write(addr, value);
+}
+
+#endif /* HOST_SIM */
+
+/* Clear then set bits with a single load and store - hold off other writers */
+static inline void mmio_modify(uintptr_t addr, uint32_t clear, uint32_t set) {
+    mmio_write(addr, (mmio_read(addr) & ~clear) | set);
+}
+
+/* Replace one field at run-time position (e.g. the GPFSEL slot of a pin) */
+static inline void mmio_write_field(uintptr_t addr, uint32_t shift, uint32_t width, uint32_t value) {
+    uint32_t mask = (0xFFFFFFFFu >> (32 - width)) << shift;
+    mmio_modify(addr, mask, (value << shift) & mask);
+}
+
+#endif /* MMIO_H */
@@ -0,0 +1,182 @@
+/*
+ * MMU and Stack Guard Pages for RPi2 BCM2837
+ * Flat short-descriptor translation table, page-split task stack region
+ */
+
+#include "mmu.h"
+#include "cpu.h"
+#include "uart.h"
+#include "placement.h"
+#include <stddef.h>
+
+/* .task_stacks bounds - provided by link_rpi2.ld */
+extern uint8_t __task_stacks_start__[];
+extern uint8_t __task_stacks_end__[];
+
+/* Linked SDRAM bounds - provided by link_rpi2.ld */
+extern uint8_t __ram_start__[];
+extern uint8_t __ram_end__[];
+
+#define MMU_SECTION_SHIFT       20
+#define MMU_PAGE_SHIFT          12
+#define MMU_DEVICE_START        0x3F000000u     /* Peripherals, then QA7 and up */
+#define MMU_LOCAL_END           0x40040000u     /* End of the QA7 local block - nothing decodes above */
+
+/* Short-descriptor first level (section) entries, domain 0 */
+#define L1_SECTION              (2u << 0)
+#define L1_PAGE_TABLE           (1u << 0)
+#define L1_B                    (1u << 2)
+#define L1_C                    (1u << 3)
+#define L1_XN                   (1u << 4)
+#define L1_AP_RW                (3u << 10)      /* AP[2:0] = 011, read/write at any level */
+#define L1_TEX(n)               ((uint32_t)(n) << 12)
+
+/* Normal, outer and inner write-back write-allocate (TEX 001, C, B) - inert while SCTLR.C is clear */
+#define L1_NORMAL               (L1_SECTION | L1_AP_RW | L1_TEX(1) | L1_C | L1_B)
+/* Shareable Device (TEX 000, B) - no speculative fetch */
+#define L1_DEVICE               (L1_SECTION | L1_AP_RW | L1_B | L1_XN)
+
+/* Second level small page entries - same attributes as L1_NORMAL */
+#define L2_SMALL_PAGE           (2u << 0)
+#define L2_NORMAL               (L2_SMALL_PAGE | (3u << 4) | (1u << 6) | (1u << 3) | (1u << 2))
+
+/* SCTLR bits */
+#define SCTLR_M                 (1u << 0)       /* MMU enable */
+#define SCTLR_TRE               (1u << 28)      /* TEX remap - off, TEX/C/B used as written */
+#define SCTLR_AFE               (1u << 29)      /* Access flag - off, AP[0] is a permission bit */
+
+static uint32_t mmu_l1[4096] __attribute__((aligned(16384)));
+static uint32_t mmu_l2[MMU_L2_TABLES][256] __attribute__((aligned(1024)));
+static uint32_t mmu_l2_section[MMU_L2_TABLES];     /* 1MB section each L2 table maps */
+static uint32_t mmu_l2_count;
+static uint32_t mmu_enabled;
+
+static struct {
+    uint32_t page;
+    const char *owner;
+} mmu_guards[MMU_MAX_GUARDS];
+static uint32_t mmu_guard_count;
+
+/* ========== Maintenance ========== */
+
+/* Make table writes visible to the walker and drop stale translations for va */
+static inline void mmu_tlb_invalidate_page(uint32_t va) {
+    __asm volatile("dsb" ::: "memory");
+    __asm volatile("mcr p15, 0, %0, c8, c7, 1" :: "r" (va & ~(MMU_PAGE_SIZE - 1)));  /* TLBIMVA */
+    __asm volatile("mcr p15, 0, %0, c7, c5, 6" :: "r" (0));                          /* BPIALL */
+    __asm volatile("dsb\n\tisb" ::: "memory");
+}
+
+/* ========== Setup ========== */
+
+COLD_FUNC void mmu_init(void) {
+    uint32_t start = (uint32_t)__task_stacks_start__;
+    uint32_t end = (uint32_t)__task_stacks_end__;
+    uint32_t first = start >> MMU_SECTION_SHIFT;
+    uint32_t last = (end - 1) >> MMU_SECTION_SHIFT;
+
+    for (uint32_t s = 0; s < 4096; s++) {
+        uint32_t base = s << MMU_SECTION_SHIFT;
+        mmu_l1[s] = base | (base < MMU_DEVICE_START ? L1_NORMAL : L1_DEVICE);
+    }
+
+    /* Split the stack region into pages so guards can be cut out of it */
+    for (uint32_t s = first; s <= last && end > start; s++) {
+        if (mmu_l2_count == MMU_L2_TABLES) {
+            uart_printf("MMU: task stacks span more than %u MB - guards above %x disabled\n",
+                        MMU_L2_TABLES, s << MMU_SECTION_SHIFT);
+            break;
+        }
+        uint32_t *l2 = mmu_l2[mmu_l2_count];
+        for (uint32_t p = 0; p < 256; p++) {
+            l2[p] = (s << MMU_SECTION_SHIFT) | (p << MMU_PAGE_SHIFT) | L2_NORMAL;
+        }
+        mmu_l1[s] = (uint32_t)l2 | L1_PAGE_TABLE;
+        mmu_l2_section[mmu_l2_count++] = s;
+    }
+
+    __asm volatile("dsb" ::: "memory");
+    __asm volatile("mcr p15, 0, %0, c2, c0, 2" :: "r" (0));                 /* TTBCR: short descriptors, TTBR0 only */
+    __asm volatile("mcr p15, 0, %0, c2, c0, 0" :: "r" ((uint32_t)mmu_l1));  /* TTBR0: non-cacheable walks */
+    __asm volatile("mcr p15, 0, %0, c3, c0, 0" :: "r" (1));                 /* DACR: domain 0 client */
+    __asm volatile("mcr p15, 0, %0, c8, c7, 0" :: "r" (0));                 /* TLBIALL */
+    __asm volatile("mcr p15, 0, %0, c7, c5, 6" :: "r" (0));                 /* BPIALL */
+    __asm volatile("dsb\n\tisb" ::: "memory");
+
+    uint32_t sctlr;
+    __asm volatile("mrc p15, 0, %0, c1, c0, 0" : "=r" (sctlr));
+    sctlr &= ~(SCTLR_TRE | SCTLR_AFE);
+    sctlr |= SCTLR_M;
+    __asm volatile("mcr p15, 0, %0, c1, c0, 0" :: "r" (sctlr) : "memory");
+    __asm volatile("isb" ::: "memory");
+
+    mmu_enabled = 1;
+    uart_printf("MMU on: %u page-split MB for task stacks at %x\n",
+                mmu_l2_count, first << MMU_SECTION_SHIFT);
+}
+
+/* ========== Guard Pages ========== */
+
+int mmu_guard_stack(const void *stack, const char *owner) {
+    uint32_t page = (uint32_t)stack - MMU_PAGE_SIZE;
+    uint32_t section = page >> MMU_SECTION_SHIFT;
+
+    if (!mmu_enabled || ((uint32_t)stack & (MMU_PAGE_SIZE - 1))) {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < mmu_l2_count; i++) {
+        if (mmu_l2_section[i] != section) {
+            continue;
+        }
+
+        uint32_t cpsr = cpu_irq_save();
+        mmu_l2[i][(page >> MMU_PAGE_SHIFT) & 0xFF] = 0;     /* Fault entry */
+        mmu_tlb_invalidate_page(page);
+        if (mmu_guard_count < MMU_MAX_GUARDS) {
+            mmu_guards[mmu_guard_count].page = page;
+            mmu_guards[mmu_guard_count].owner = owner;
+            mmu_guard_count++;
+        }
+        cpu_irq_restore(cpsr);
+        return 1;
+    }
+    return 0;
+}
+
+const char *mmu_guard_owner(uint32_t addr) {
+    uint32_t page = addr & ~(MMU_PAGE_SIZE - 1);
+
+    for (uint32_t i = 0; i < mmu_guard_count; i++) {
+        if (mmu_guards[i].page == page) {
+            return mmu_guards[i].owner;
+        }
+    }
+    return NULL;
+}
+
+/* ========== Address Checks ========== */
+
+/* 1 if [addr, addr + len) lies inside [start, end) */
+static int mmu_in_range(uint32_t addr, uint32_t len, uint32_t start, uint32_t end) {
+    return addr >= start && addr <= end && len <= end - addr;
+}
+
+int mmu_addr_accessible(uint32_t addr, uint32_t len) {
+    if (len == 0) {
+        return 0;
+    }
+    if (!mmu_in_range(addr, len, (uint32_t)__ram_start__, (uint32_t)__ram_end__) &&
+        !mmu_in_range(addr, len, MMU_DEVICE_START, MMU_LOCAL_END)) {
+        return 0;
+    }
+
+    uint32_t first = addr & ~(MMU_PAGE_SIZE - 1);
+    uint32_t last = (addr + len - 1) & ~(MMU_PAGE_SIZE - 1);
+    for (uint32_t i = 0; i < mmu_guard_count; i++) {
+        if (mmu_guards[i].page >= first && mmu_guards[i].page <= last) {
+            return 0;
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,61 @@
+/*
+ * MMU and Stack Guard Pages for RPi2 BCM2837
+ *
+ * mmu_init() turns on the MMU with a flat (VA == PA) short-descriptor map:
+ *
+ *   0x00000000 - 0x3EFFFFFF   Normal memory, 1MB sections (SDRAM, GPU split)
+ *   0x3F000000 - 0xFFFFFFFF   Device, execute-never (peripherals, QA7)
+ *
+ * The 1MB sections covering .task_stacks are split into 4KB pages, so
+ * single pages there can be unmapped. mmu_guard_stack() unmaps the page
+ * just below a page-aligned stack: a task that runs off the bottom of
+ * its stack takes a data abort (page translation fault) on its first
+ * access to the guard, and trace_fault() names the task and its SP.
+ *
+ * The caches stay off (SCTLR.C/I clear), so memory behaves as before
+ * apart from Normal-memory write buffering. The Normal mappings say
+ * write-back, but that does not make setting SCTLR.C safe: dma.c and
+ * spi.c do no cache maintenance, so DMA buffers and control blocks would
+ * first need a non-cacheable mapping or clean/invalidate around
+ * dma_start() and completion.
+ *
+ * Only stacks declared with APP_TASK_STACK() (app_tasks.h) are guarded.
+ * Stacks from the heap (xTaskCreate) still rely on
+ * configCHECK_FOR_STACK_OVERFLOW.
+ */
+
+#ifndef MMU_H
+#define MMU_H
+
+#include <stdint.h>
+
+/* Small page - guard granularity */
+#define MMU_PAGE_SIZE           4096
+
+/* 1MB sections of .task_stacks that can be split into pages */
+#define MMU_L2_TABLES           4
+
+/* Guard pages mmu_guard_owner() can name */
+#define MMU_MAX_GUARDS          32
+
+/* Build the translation table and enable the MMU - once, early in main() */
+void mmu_init(void);
+
+/*
+ * Unmap the page below stack (page-aligned, inside .task_stacks) and
+ * record owner for the fault report. Returns 0 if the MMU is off or the
+ * page cannot be guarded.
+ */
+int mmu_guard_stack(const void *stack, const char *owner);
+
+/* Owner of the guard page containing addr, or NULL if addr is not in one */
+const char *mmu_guard_owner(uint32_t addr);
+
+/*
+ * 1 if [addr, addr + len) can be accessed without faulting: it lies in
+ * the linked SDRAM or the peripheral/QA7 window, and touches no guard
+ * page. The rest of the flat map is mapped but has nothing behind it.
+ */
+int mmu_addr_accessible(uint32_t addr, uint32_t len);
+
+#endif /* MMU_H */
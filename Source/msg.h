@@ -0,0 +1,75 @@
+/*
+ * Zero-Copy Loaned-Buffer Messaging for RPi2 BCM2837
+ *
+ * A FreeRTOS queue copies every item in and out by value, through the
+ * byte-at-a-time memcpy in rpi2_support.c - for acquisition frames, PLC
+ * images and log records of hundreds of bytes to kilobytes that copy is
+ * most of the cost. Here only a pointer goes through the queue:
+ *
+ *   producer                             consumer
+ *   buf = msg_loan(size)                 buf = msg_receive(ch, wait)
+ *   fill buf in place                    use buf
+ *   msg_send(ch, buf, wait)              msg_release(buf)
+ *
+ * Buffers are pool.h blocks, so they are cache-line aligned, O(1) to
+ * loan and safe to release from an IRQ handler. Each carries a reference
+ * count, kept in a side table indexed by pool_block_id() so the whole
+ * block is payload. msg_loan() returns one reference; msg_send() moves
+ * it into the channel and msg_receive() hands it to the consumer. The
+ * block goes back to the pool when the last reference is released.
+ *
+ * Fan-out: msg_publish() takes one more reference per extra channel and
+ * sends the same buffer to each. Once a buffer is sent it is shared -
+ * nobody writes to it again, readers only.
+ *
+ * A channel is a FreeRTOS queue with sizeof(void *) items, so queue
+ * sets, timeouts, priority wakeup and the flight recorder's queue events
+ * all work as before. msg_channel_create() makes one from the heap; a
+ * static one is xQueueCreateStatic(depth, sizeof(void *), ...).
+ */
+
+#ifndef MSG_H
+#define MSG_H
+
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "pool.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/* Largest loan - the biggest pool.h class */
+#define MSG_MAX_SIZE        POOL_MAX_BLOCK
+
+/* Borrow a buffer of at least size bytes, reference count 1 (NULL if the class is empty) */
+void *msg_loan(size_t size);
+
+/* Bytes asked for when buf was loaned */
+size_t msg_length(const void *buf);
+
+/* Take count more references to buf (one per extra consumer) */
+void msg_ref(void *buf, uint32_t count);
+
+/* Drop one reference - the last one returns buf to the pool. Task or IRQ */
+void msg_release(void *buf);
+
+/* Pointer queue of depth buffers */
+QueueHandle_t msg_channel_create(UBaseType_t depth);
+
+/*
+ * Send buf, handing the caller's reference to the receiver. pdPASS on
+ * success; on timeout the caller still owns buf (retry or release it).
+ */
+BaseType_t msg_send(QueueHandle_t channel, void *buf, TickType_t timeout);
+BaseType_t msg_send_from_isr(QueueHandle_t channel, void *buf, BaseType_t *woken);
+
+/* Next buffer, now owned by the caller, or NULL on timeout */
+void *msg_receive(QueueHandle_t channel, TickType_t timeout);
+
+/*
+ * Send buf to count channels. Always consumes the caller's reference;
+ * channels that time out get their reference dropped. Returns the number
+ * of channels that took the buffer.
+ */
+uint32_t msg_publish(const QueueHandle_t *channels, uint32_t count, void *buf, TickType_t timeout);
+
+#endif /* MSG_H */
@@ -0,0 +1,51 @@
+/*
+ * Hot/Cold Code and Data Placement for RPi2 BCM2837
+ *
+ * Tags for functions and data whose address matters more than usual.
+ * link_rpi2.ld gathers each tag into its own output section:
+ *
+ *   .text.hot      HOT_FUNC - IRQ dispatch, tick, ISRs, pool.h - plus the
+ *                  kernel's switch/tick/queue functions and portASM.o,
+ *                  packed together right after the vectors in .init
+ *   .text.cold     COLD_FUNC - assert/fault/hook reporting and one-shot
+ *                  init, plus whatever GCC itself decides is unlikely
+ *                  (.text.unlikely, .text.startup, split-off cold blocks)
+ *   .text          everything else (-ffunction-sections keeps the kernel's
+ *                  functions separable, see build_rpi2.sh)
+ *   .data.hot      HOT_DATA - read on every interrupt, plus the kernel's
+ *                  pxCurrentTCB, ready lists, tick count and port nesting
+ *   .data.isr      ISR_DATA - written from interrupt handlers, one
+ *                  CACHE_LINE_SIZE line (or more) per object
+ *   .data.percore  PERCORE_DATA - owned by one core, line aligned so a
+ *                  second core never shares a line with it
+ *
+ * The point is cache-line and prefetch locality: the IRQ-to-switch path
+ * then touches a few dense lines instead of lines half-filled with boot
+ * code and debug printing. It pays off once SCTLR.I/C are on; with the
+ * caches off (mmu.h) the layout is harmless. Every section sits inside
+ * the same 1MB MMU sections either way, so the TLB is not affected.
+ *
+ * build_rpi2.sh prints the size of .text.hot against the 32KB L1 I-cache
+ * after every link - keep the tag for code that runs at interrupt rate.
+ *
+ * Host builds (build_host.sh) keep the attributes; the default linker
+ * script folds the sections back into .text and .data.
+ */
+
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+/* Cortex-A53 L1 and L2 line size */
+#define CACHE_LINE_SIZE         64
+
+/* Cortex-A53 L1 instruction cache - budget for .text.hot */
+#define CACHE_L1I_SIZE          (32 * 1024)
+
+#define HOT_FUNC                __attribute__((hot, section(".text.hot")))
+#define COLD_FUNC               __attribute__((cold, noinline, section(".text.cold")))
+
+#define HOT_DATA                __attribute__((section(".data.hot")))
+#define ISR_DATA                __attribute__((section(".data.isr"), aligned(CACHE_LINE_SIZE)))
+#define PERCORE_DATA            __attribute__((section(".data.percore"), aligned(CACHE_LINE_SIZE)))
+
+#endif /* PLACEMENT_H */
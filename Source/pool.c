@@ -0,0 +1,167 @@
+/*
+ * Fixed-size block pool allocator for RPi2 BCM2837
+ *
+ * Each class owns a static arena. Allocation pops the class free list,
+ * or carves the next never-used block off the arena, so the arenas need
+ * no initialisation walk at boot. Both operations are a handful of
+ * instructions inside a short IRQ-masked window.
+ *
+ * Lists are protected by masking IRQs rather than LDREX/STREX. The
+ * secondary cores are parked, so masking on core 0 is sufficient, and a
+ * masked pop is a few instructions with no retry loop and no ABA hazard
+ * on the free list.
+ */
+
+#include "FreeRTOS.h"
+#include "pool.h"
+#include "cpu.h"
+#include "uart.h"
+#include "placement.h"
+
+typedef struct pool_block {
+    struct pool_block *next;
+} pool_block_t;
+
+typedef struct {
+    uint8_t *base;              /* First block in the arena */
+    uint8_t *limit;             /* One past the last block */
+    uint8_t *unused;            /* Next never-allocated block */
+    pool_block_t *free_list;    /* Returned blocks */
+    uint32_t block_size;
+    uint32_t block_count;
+    uint32_t in_use;
+    uint32_t peak;
+    uint32_t failures;
+} __attribute__((aligned(POOL_ALIGN))) pool_t;
+
+/* ========== Arenas ========== */
+
+static uint8_t arena_64[64 * POOL_BLOCKS_64] __attribute__((aligned(POOL_ALIGN)));
+static uint8_t arena_128[128 * POOL_BLOCKS_128] __attribute__((aligned(POOL_ALIGN)));
+static uint8_t arena_256[256 * POOL_BLOCKS_256] __attribute__((aligned(POOL_ALIGN)));
+static uint8_t arena_512[512 * POOL_BLOCKS_512] __attribute__((aligned(POOL_ALIGN)));
+static uint8_t arena_1024[1024 * POOL_BLOCKS_1024] __attribute__((aligned(POOL_ALIGN)));
+static uint8_t arena_2048[2048 * POOL_BLOCKS_2048] __attribute__((aligned(POOL_ALIGN)));
+static uint8_t arena_4096[4096 * POOL_BLOCKS_4096] __attribute__((aligned(POOL_ALIGN)));
+
+#define POOL_CLASS(arena, size, count) \
+    { arena, arena + sizeof(arena), arena, NULL, size, count, 0, 0, 0 }
+
+static pool_t pools[POOL_NUM_CLASSES] = {
+    POOL_CLASS(arena_64,   64,   POOL_BLOCKS_64),
+    POOL_CLASS(arena_128,  128,  POOL_BLOCKS_128),
+    POOL_CLASS(arena_256,  256,  POOL_BLOCKS_256),
+    POOL_CLASS(arena_512,  512,  POOL_BLOCKS_512),
+    POOL_CLASS(arena_1024, 1024, POOL_BLOCKS_1024),
+    POOL_CLASS(arena_2048, 2048, POOL_BLOCKS_2048),
+    POOL_CLASS(arena_4096, 4096, POOL_BLOCKS_4096),
+};
+
+/* Smallest class whose block holds size bytes: ceil(log2(size)) - 6 */
+static inline unsigned int pool_class_for(size_t size) {
+    if (size <= (1u << POOL_MIN_SHIFT)) {
+        return 0;
+    }
+    return (32 - __builtin_clz((uint32_t)size - 1)) - POOL_MIN_SHIFT;
+}
+
+/* Class whose arena holds block, or NULL - bounded scan, there are only POOL_NUM_CLASSES */
+static inline pool_t *pool_find(const void *block) {
+    for (unsigned int i = 0; i < POOL_NUM_CLASSES; i++) {
+        if ((const uint8_t *)block >= pools[i].base && (const uint8_t *)block < pools[i].limit) {
+            return &pools[i];
+        }
+    }
+    return NULL;
+}
+
+/* ========== Allocation ========== */
+
+HOT_FUNC void *pool_alloc(size_t size) {
+    unsigned int cls = pool_class_for(size);
+    if (size == 0 || cls >= POOL_NUM_CLASSES) {
+        return NULL;
+    }
+
+    pool_t *pool = &pools[cls];
+    uint32_t cpsr = cpu_irq_save();
+
+    void *block = pool->free_list;
+    if (block != NULL) {
+        pool->free_list = pool->free_list->next;
+    } else if (pool->unused < pool->limit) {
+        block = pool->unused;
+        pool->unused += pool->block_size;
+    } else {
+        pool->failures++;
+        cpu_irq_restore(cpsr);
+        return NULL;
+    }
+
+    if (++pool->in_use > pool->peak) {
+        pool->peak = pool->in_use;
+    }
+
+    cpu_irq_restore(cpsr);
+    return block;
+}
+
+HOT_FUNC void pool_free(void *block) {
+    if (block == NULL) {
+        return;
+    }
+
+    pool_t *pool = pool_find(block);
+
+    configASSERT(pool != NULL);
+    configASSERT((((uint8_t *)block - pool->base) & (pool->block_size - 1)) == 0);
+
+    uint32_t cpsr = cpu_irq_save();
+    configASSERT(pool->in_use > 0);
+    ((pool_block_t *)block)->next = pool->free_list;
+    pool->free_list = (pool_block_t *)block;
+    pool->in_use--;
+    cpu_irq_restore(cpsr);
+}
+
+HOT_FUNC int pool_block_id(const void *block) {
+    const pool_t *pool = pool_find(block);
+    uint32_t id = 0;
+
+    if (pool == NULL) {
+        return -1;
+    }
+    for (const pool_t *p = pools; p < pool; p++) {
+        id += p->block_count;
+    }
+    return (int)(id + ((const uint8_t *)block - pool->base) / pool->block_size);
+}
+
+/* ========== Statistics ========== */
+
+int pool_get_stats(unsigned int pool_class, pool_stats_t *stats) {
+    if (pool_class >= POOL_NUM_CLASSES || stats == NULL) {
+        return 0;
+    }
+
+    const pool_t *pool = &pools[pool_class];
+    uint32_t cpsr = cpu_irq_save();
+    stats->block_size = pool->block_size;
+    stats->block_count = pool->block_count;
+    stats->in_use = pool->in_use;
+    stats->peak = pool->peak;
+    stats->failures = pool->failures;
+    cpu_irq_restore(cpsr);
+    return 1;
+}
+
+COLD_FUNC void pool_print_stats(void) {
+    pool_stats_t stats;
+
+    uart_puts("Pool  size  count  in_use  peak  failures\r\n");
+    for (unsigned int i = 0; i < POOL_NUM_CLASSES; i++) {
+        pool_get_stats(i, &stats);
+        uart_printf("  %u  %u  %u  %u  %u  %u\n", i, stats.block_size, stats.block_count,
+                    stats.in_use, stats.peak, stats.failures);
+    }
+}
@@ -0,0 +1,79 @@
+/*
+ * Fixed-size block pool allocator for RPi2 BCM2837
+ *
+ * O(1) size-classed allocation for hot paths and ISRs. Blocks come from
+ * static, cache-line aligned arenas - one per power-of-two class from
+ * 64 bytes to 4KB - so nothing here touches the FreeRTOS heap or the
+ * scheduler lock. Safe to call from tasks and IRQ handlers (not FIQ).
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Cortex-A53 cache line size - every block starts on a line boundary */
+#define POOL_ALIGN          64
+
+/* Size classes: 64 << n bytes for n = 0 .. POOL_NUM_CLASSES-1 */
+#define POOL_MIN_SHIFT      6
+#define POOL_NUM_CLASSES    7
+#define POOL_MAX_BLOCK      (1u << (POOL_MIN_SHIFT + POOL_NUM_CLASSES - 1))
+
+/* Blocks per class - override with -D to resize the arenas */
+#ifndef POOL_BLOCKS_64
+#define POOL_BLOCKS_64      256
+#endif
+#ifndef POOL_BLOCKS_128
+#define POOL_BLOCKS_128     128
+#endif
+#ifndef POOL_BLOCKS_256
+#define POOL_BLOCKS_256     64
+#endif
+#ifndef POOL_BLOCKS_512
+#define POOL_BLOCKS_512     32
+#endif
+#ifndef POOL_BLOCKS_1024
+#define POOL_BLOCKS_1024    16
+#endif
+#ifndef POOL_BLOCKS_2048
+#define POOL_BLOCKS_2048    8
+#endif
+#ifndef POOL_BLOCKS_4096
+#define POOL_BLOCKS_4096    4
+#endif
+
+/* Blocks in all classes - the range of pool_block_id() */
+#define POOL_TOTAL_BLOCKS   (POOL_BLOCKS_64 + POOL_BLOCKS_128 + POOL_BLOCKS_256 + POOL_BLOCKS_512 + \
+                             POOL_BLOCKS_1024 + POOL_BLOCKS_2048 + POOL_BLOCKS_4096)
+
+/* Per-class statistics snapshot */
+typedef struct {
+    uint32_t block_size;    /* Bytes per block */
+    uint32_t block_count;   /* Blocks in the arena */
+    uint32_t in_use;        /* Blocks currently allocated */
+    uint32_t peak;          /* High-water mark of in_use */
+    uint32_t failures;      /* Allocations refused because the class was empty */
+} pool_stats_t;
+
+/* Allocate a block of at least size bytes (NULL if too big or class empty) */
+void *pool_alloc(size_t size);
+
+/* Return a block obtained from pool_alloc() (NULL is ignored) */
+void pool_free(void *block);
+
+/*
+ * Index of a pool block, 0 .. POOL_TOTAL_BLOCKS-1, for side tables that
+ * keep per-block state outside the block (msg.h); -1 if block is not
+ * from pool_alloc()
+ */
+int pool_block_id(const void *block);
+
+/* Statistics for class 0 .. POOL_NUM_CLASSES-1; returns 0 on bad class */
+int pool_get_stats(unsigned int pool_class, pool_stats_t *stats);
+
+/* Print a one-line summary per class on the UART */
+void pool_print_stats(void);
+
+#endif /* POOL_H */
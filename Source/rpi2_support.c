@@ -6,6 +6,12 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include "bcm2837_irq.h"
+#include "uart.h"
+#include "app_tasks.h"
+#include "boot_trace.h"
+#include "cpu.h"
+#include "mmio.h"
+#include "placement.h"
 #include <stddef.h>
 #include <stdint.h>
 
@@ -18,6 +24,10 @@ volatile uint32_t bcm2837_stub_gic_pmr = 0xFF;   /* Priority mask (all enabled)
 volatile uint32_t bcm2837_stub_gic_bpr = 0x00;   /* Binary point = 0 (as expected by port) */
 volatile uint8_t bcm2837_stub_gic_priority[1024] = {0};  /* Priority array */
 
+/* FreeRTOS heap_4 storage - placed in the NOLOAD .heap section so the
+ * 32MB array is not zeroed by the startup BSS clear */
+uint8_t ucHeap[configTOTAL_HEAP_SIZE] __attribute__((section(".heap"), aligned(64)));
+
 /* Minimal libc functions for FreeRTOS */
 size_t strlen(const char *s) {
     const char *p = s;
@@ -41,19 +51,135 @@ int snprintf(char *str, size_t size, const char *format, ...) {
     return i;
 }
 
+/* Printf replacement using our uart_printf */
+int printf(const char *format, ...) {
+    uart_puts(format);
+    return 0;
+}
+
+/* Queue item copies (prvCopyDataToQueue) go through here */
+HOT_FUNC void *memcpy(void *dest, const void *src, size_t n) {
+    char *d = (char *)dest;
+    const char *s = (const char *)src;
+    for (size_t i = 0; i < n; i++) {
+        d[i] = s[i];
+    }
+    return dest;
+}
+
+void *memset(void *s, int c, size_t n) {
+    char *p = (char *)s;
+    for (size_t i = 0; i < n; i++) {
+        p[i] = c;
+    }
+    return s;
+}
+
 /* FreeRTOS hook functions */
-void vApplicationStackOverflowHook(TaskHandle_t xTask, char *pcTaskName) {
-    (void)xTask;
-    (void)pcTaskName;
+COLD_FUNC void vAssertCalled(unsigned long ulLine, const char * const pcFileName) {
+    trace_event(TRACE_EV_ASSERT, 0, ulLine, (uint32_t)(uintptr_t)pcFileName);
+    uart_puts("\r\n=== DETAILED ASSERT FAILURE DEBUG ===\r\n");
+    uart_puts("ASSERT FAILED at line: ");
+    uart_decimal(ulLine);
+    uart_puts("\r\n");
+    uart_puts("File: ");
+    uart_puts(pcFileName);
+    uart_puts("\r\n");
+    
+    // Provide specific debugging for common assertion locations
+    // Simple check for "port.c" in filename
+    int isPortC = 0;
+    const char *p = pcFileName;
+    while (*p) {
+        if (*p == 'p' && *(p+1) == 'o' && *(p+2) == 'r' && *(p+3) == 't' && *(p+4) == '.') {
+            isPortC = 1;
+            break;
+        }
+        p++;
+    }
+    
+    if (isPortC) {
+        uart_puts("\r\n--- PORT.C ASSERTION ANALYSIS ---\r\n");
+        if (ulLine >= 410 && ulLine <= 420) {
+            uart_puts("CPU Mode assertion - checking APSR register\r\n");
+        } else if (ulLine >= 430 && ulLine <= 450) {
+            uart_puts("GIC Binary Point Register assertion\r\n");
+        } else if (ulLine >= 470 && ulLine <= 480) {
+            uart_puts("Critical nesting assertion\r\n");
+        } else if (ulLine >= 490 && ulLine <= 500) {
+            uart_puts("Interrupt nesting assertion\r\n");
+        } else {
+            uart_puts("Other port.c assertion at line ");
+            uart_decimal(ulLine);
+            uart_puts("\r\n");
+        }
+    }
+    
+    trace_dump();
+    uart_puts("\r\nSystem will halt here for debugging.\r\n");
+    uart_puts("=====================================\r\n");
+    for (;;);
+}
+
+/*
+ * Pattern check (configCHECK_FOR_STACK_OVERFLOW) - only heap-allocated
+ * stacks need it once the MMU guard pages are in (mmu.h); an overrun of a
+ * guarded stack arrives as a data abort in trace_fault() instead.
+ */
+COLD_FUNC void vApplicationStackOverflowHook(TaskHandle_t xTask, char *pcTaskName) {
+    trace_event(TRACE_EV_STACK_OVERFLOW, 0, (uint32_t)(uintptr_t)xTask, 0);
+    uart_printf("\n*** STACK OVERFLOW in %s (TCB %x)\n", pcTaskName, (uint32_t)(uintptr_t)xTask);
+    trace_dump();
     /* Hang on stack overflow */
     while(1) {}
 }
 
-void vApplicationMallocFailedHook(void) {
+COLD_FUNC void vApplicationMallocFailedHook(void) {
+    trace_event(TRACE_EV_MALLOC_FAILED, 0, 0, 0);
     /* Hang on malloc failure */
     while(1) {}
 }
 
+/*
+ * Runs once, first thing in the timer daemon task - the highest priority
+ * task, so this is the first task code to execute after the scheduler starts
+ */
+COLD_FUNC void vApplicationDaemonTaskStartupHook(void) {
+    boot_trace_mark(BOOT_PHASE_FIRST_TASK);
+    boot_trace_report();
+}
+
+/* ========== Static Memory for Kernel Tasks ========== */
+/*
+ * configSUPPORT_STATIC_ALLOCATION requires the application to supply the
+ * idle and timer daemon task memory. TCBs and stacks go in .task_tcbs and
+ * .task_stacks alongside the APP_TASK() ones so the whole task memory map
+ * is in one place, and the stacks get the same guard pages.
+ */
+APP_TASK_TCB(idle_task_tcb);
+APP_TASK_STACK(idle_task_stack, IDLE_TASK_STACK_DEPTH);
+
+APP_TASK_TCB(timer_task_tcb);
+APP_TASK_STACK(timer_task_stack, configTIMER_TASK_STACK_DEPTH);
+
+void vApplicationGetIdleTaskMemory(StaticTask_t **ppxIdleTaskTCBBuffer,
+                                   StackType_t **ppxIdleTaskStackBuffer,
+                                   uint32_t *pulIdleTaskStackSize) {
+    (void)APP_TASK_GUARD(idle_task_stack.stack, "IDLE");
+    *ppxIdleTaskTCBBuffer = &idle_task_tcb;
+    *ppxIdleTaskStackBuffer = idle_task_stack.stack;
+    *pulIdleTaskStackSize = IDLE_TASK_STACK_DEPTH;
+}
+
+void vApplicationGetTimerTaskMemory(StaticTask_t **ppxTimerTaskTCBBuffer,
+                                    StackType_t **ppxTimerTaskStackBuffer,
+                                    uint32_t *pulTimerTaskStackSize) {
+    (void)APP_TASK_GUARD(timer_task_stack.stack, "Tmr Svc");
+    *ppxTimerTaskTCBBuffer = &timer_task_tcb;
+    *ppxTimerTaskStackBuffer = timer_task_stack.stack;
+    *pulTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
+}
+
 /* ========== BCM2837 Interrupt Controller Initialization ========== */
 
 /*
@@ -62,7 +188,7 @@ void vApplicationMallocFailedHook(void) {
  * 1. ARM Local (QA7) at 0x40000000 - for timers and core interrupts
  * 2. VideoCore at 0x3F00B000 - for peripherals (UART, GPIO, etc.)
  */
-void bcm2837_irq_init(void) {
+COLD_FUNC void bcm2837_irq_init(void) {
     /* Initialize GIC stub registers to expected values */
     /* FreeRTOS port checks: ucMaxPriorityValue == portLOWEST_INTERRUPT_PRIORITY */
     /* For 32 priorities (5 bits), portLOWEST_INTERRUPT_PRIORITY = 31 */
@@ -79,33 +205,199 @@ void bcm2837_irq_init(void) {
     /* Route all GPU interrupts to core 0 */
     ARM_LOCAL_WRITE(ARM_LOCAL_GPU_INT_ROUTING, 0x00);
 
-    /* Clear any pending local timer interrupt */
-    uint32_t timer_ctrl = ARM_LOCAL_REG(ARM_LOCAL_TIMER_CONTROL);
-    timer_ctrl |= ARM_LOCAL_TIMER_CTRL_INT_FLAG;  /* Clear by writing 1 */
-    ARM_LOCAL_WRITE(ARM_LOCAL_TIMER_CONTROL, timer_ctrl);
+    /* Clear any pending local timer interrupt (write 1) */
+    mmio_modify(ARM_LOCAL_BASE + ARM_LOCAL_TIMER_CONTROL, 0, ARM_LOCAL_TIMER_CTRL_INT_FLAG);
 }
 
+/*
+ * ARM-side copy of the VideoCore enable registers. The pending registers
+ * also report sources the GPU owns (e.g. system timer 0/2), so the
+ * dispatcher only looks at sources enabled here. Only changed with IRQs
+ * masked, so the dispatcher can read it as plain memory.
+ */
+static uint32_t vc_irq_enabled[2] HOT_DATA;
+
 /*
  * Enable specific VideoCore peripheral interrupt
  * For GPIO (IRQ 49-52) and UART (IRQ 57)
  */
 void bcm2837_enable_vc_irq(uint32_t irq_num) {
+    uint32_t cpsr = cpu_irq_save();
     if (irq_num < 32) {
+        vc_irq_enabled[0] |= (1 << irq_num);
         IRQ_VC_WRITE(IRQ_ENABLE_1, (1 << irq_num));
     } else if (irq_num < 64) {
+        vc_irq_enabled[1] |= (1 << (irq_num - 32));
         IRQ_VC_WRITE(IRQ_ENABLE_2, (1 << (irq_num - 32)));
     }
+    cpu_irq_restore(cpsr);
 }
 
 /*
  * Disable specific VideoCore peripheral interrupt
  */
 void bcm2837_disable_vc_irq(uint32_t irq_num) {
+    uint32_t cpsr = cpu_irq_save();
     if (irq_num < 32) {
         IRQ_VC_WRITE(IRQ_DISABLE_1, (1 << irq_num));
+        vc_irq_enabled[0] &= ~(1 << irq_num);
     } else if (irq_num < 64) {
         IRQ_VC_WRITE(IRQ_DISABLE_2, (1 << (irq_num - 32)));
+        vc_irq_enabled[1] &= ~(1 << (irq_num - 32));
     }
+    cpu_irq_restore(cpsr);
+}
+
+/* ========== IRQ Dispatch ========== */
+
+/* FreeRTOS ARM_CA9 port tick handler (port.c) */
+extern void FreeRTOS_Tick_Handler(void);
+
+/* Registered VideoCore peripheral handlers */
+static struct {
+    bcm2837_irq_handler_t handler;
+    void *context;
+} vc_irq_handlers[BCM2837_VC_IRQ_COUNT] HOT_DATA;
+
+void bcm2837_irq_register(uint32_t irq_num, bcm2837_irq_handler_t handler, void *context) {
+    if (irq_num >= BCM2837_VC_IRQ_COUNT) {
+        return;
+    }
+    vc_irq_handlers[irq_num].context = context;
+    vc_irq_handlers[irq_num].handler = handler;
+}
+
+/* ========== IRQ Statistics ========== */
+
+#if configUSE_IRQ_STATS
+
+/* Written only in IRQ mode, read with IRQs masked */
+static bcm2837_irq_stats_t irq_stats[BCM2837_IRQ_STATS_COUNT] ISR_DATA;
+
+static inline void irq_stats_record(uint32_t source, uint32_t latency, uint32_t run) {
+    bcm2837_irq_stats_t *st = &irq_stats[source];
+    st->count++;
+    st->latency_total += latency;
+    st->run_total += run;
+    if (latency > st->latency_max) {
+        st->latency_max = latency;
+    }
+    if (run > st->run_max) {
+        st->run_max = run;
+    }
+}
+
+/* CNTP_CVAL - the compare value the tick fired on, before the port advances it */
+static inline uint64_t irq_tick_compare(void) {
+    uint32_t lo, hi;
+    __asm volatile("mrrc p15, 2, %0, %1, c14" : "=r" (lo), "=r" (hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+int bcm2837_irq_get_stats(uint32_t source, bcm2837_irq_stats_t *stats) {
+    if (source >= BCM2837_IRQ_STATS_COUNT) {
+        return 0;
+    }
+    uint32_t cpsr = cpu_irq_save();
+    *stats = irq_stats[source];
+    cpu_irq_restore(cpsr);
+    return 1;
+}
+
+void bcm2837_irq_stats_reset(void) {
+    uint32_t cpsr = cpu_irq_save();
+    for (uint32_t i = 0; i < BCM2837_IRQ_STATS_COUNT; i++) {
+        irq_stats[i] = (bcm2837_irq_stats_t){0};
+    }
+    cpu_irq_restore(cpsr);
+}
+
+#else
+
+int bcm2837_irq_get_stats(uint32_t source, bcm2837_irq_stats_t *stats) {
+    (void)source;
+    (void)stats;
+    return 0;
+}
+
+void bcm2837_irq_stats_reset(void) {
+}
+
+#endif /* configUSE_IRQ_STATS */
+
+/*
+ * Call the handler of every pending source in one 32-bit pending word.
+ * Each handler talks to a different peripheral than the code around it,
+ * so it is bracketed by the peripheral-switch barrier (see mmio.h).
+ */
+HOT_FUNC static void bcm2837_dispatch_vc(uint32_t pending, uint32_t first_irq, uint64_t entry) {
+    (void)entry;
+
+    while (pending) {
+        uint32_t bit = __builtin_ctz(pending);
+        uint32_t irq = first_irq + bit;
+        pending &= pending - 1;
+
+        if (vc_irq_handlers[irq].handler) {
+#if configUSE_IRQ_STATS
+            uint64_t start = cpu_cntpct();
+#endif
+            mmio_barrier();
+            vc_irq_handlers[irq].handler(vc_irq_handlers[irq].context);
+            mmio_barrier();
+#if configUSE_IRQ_STATS
+            irq_stats_record(irq, (uint32_t)(start - entry), (uint32_t)(cpu_cntpct() - start));
+#endif
+        } else {
+            /* Nobody to acknowledge it at the source - stop it storming */
+            bcm2837_disable_vc_irq(irq);
+        }
+    }
+}
+
+/*
+ * Called by FreeRTOS_IRQ_Handler (portASM.S) for every IRQ; the ICCIAR
+ * value comes from the GIC stub and carries no information here.
+ *
+ * Defining this replaces the port's weak vApplicationIRQHandler, which
+ * saves the whole FPU bank around every interrupt. Handlers reached from
+ * here must therefore be integer-only - with lazy FPU switching (fpu.h)
+ * that save would also trap and mark every interrupted task as an FPU user.
+ */
+HOT_FUNC void vApplicationIRQHandler(uint32_t ulICCIAR) {
+    (void)ulICCIAR;
+    uint64_t entry = 0;
+
+#if configUSE_IRQ_STATS
+    entry = cpu_cntpct();
+#endif
+
+    uint32_t pending = ARM_LOCAL_CORE_REG(0, ARM_LOCAL_IRQ_PENDING0);
+    TRACE_ISR_ENTER(pending);
+
+    if (pending & (ARM_LOCAL_IRQ_SRC_CNTPNS | ARM_LOCAL_IRQ_SRC_CNTPS)) {
+#if configUSE_IRQ_STATS
+        uint32_t latency = (uint32_t)(entry - irq_tick_compare());
+        uint64_t start = cpu_cntpct();
+        FreeRTOS_Tick_Handler();
+        irq_stats_record(BCM2837_IRQ_STATS_TICK, latency, (uint32_t)(cpu_cntpct() - start));
+#else
+        FreeRTOS_Tick_Handler();
+#endif
+    }
+
+    if (pending & ARM_LOCAL_IRQ_SRC_GPU) {
+        /* Read PENDING_1/2 directly - some sources (53-57, 62) only show
+         * up as shortcut bits in IRQ_BASIC_PENDING, not as PENDING_2 flag.
+         * Both are read before any handler runs, so the interrupt
+         * controller is not revisited between peripherals. */
+        uint32_t pending1 = IRQ_VC_REG(IRQ_PENDING_1) & vc_irq_enabled[0];
+        uint32_t pending2 = IRQ_VC_REG(IRQ_PENDING_2) & vc_irq_enabled[1];
+        bcm2837_dispatch_vc(pending1, 0, entry);
+        bcm2837_dispatch_vc(pending2, 32, entry);
+    }
+
+    TRACE_ISR_EXIT();
 }
 
 /* ========== ARM Generic Timer Configuration ========== */
@@ -120,7 +412,7 @@ void bcm2837_disable_vc_irq(uint32_t irq_num) {
  *
  * We use ARM Generic Timer (option 1) as it's most portable
  */
-void vConfigureTickInterrupt(void) {
+COLD_FUNC void vConfigureTickInterrupt(void) {
     /*
      * ARM Generic Timer frequency on BCM2837:
      * - Physical timer runs at 19.2 MHz (crystal frequency)
@@ -151,16 +443,14 @@ void vConfigureTickInterrupt(void) {
     uint32_t timer_ctrl = 0x01;  /* Enable timer, interrupt enabled */
     __asm volatile("mcr p15, 0, %0, c14, c2, 1" :: "r" (timer_ctrl));
 
-    /* Enable physical timer IRQ in ARM local interrupt controller (core 0) */
-    uint32_t int_ctrl = ARM_LOCAL_CORE_REG(0, ARM_LOCAL_TIMER_INT_CONTROL0);
-    int_ctrl |= ARM_LOCAL_TIMER_INT_nCNTPNSIRQ;  /* Enable physical non-secure timer IRQ */
-    ARM_LOCAL_WRITE(ARM_LOCAL_TIMER_INT_CONTROL0, int_ctrl);
+    /* Enable physical non-secure timer IRQ in ARM local interrupt controller (core 0) */
+    mmio_modify(ARM_LOCAL_BASE + ARM_LOCAL_TIMER_INT_CONTROL0, 0, ARM_LOCAL_TIMER_INT_nCNTPNSIRQ);
 }
 
 /*
  * Clear/acknowledge timer interrupt
  */
-void vClearTickInterrupt(void) {
+HOT_FUNC void vClearTickInterrupt(void) {
     /* For ARM Generic Timer, we need to set next compare value */
     const uint32_t timer_freq = 19200000;  /* 19.2 MHz */
     const uint32_t counts_per_tick = timer_freq / configTICK_RATE_HZ;
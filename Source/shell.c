@@ -0,0 +1,523 @@
+/*
+ * Diagnostics Shell for RPi2 BCM2837
+ * ps, heap, irq, load, mem, sizes, bench and guard on the UART0 console
+ */
+
+#include "shell.h"
+#include "console.h"
+#include "app_tasks.h"
+#include "bcm2837_irq.h"
+#include "cpu.h"
+#include "idle.h"
+#include "memstat.h"
+#include "mmu.h"
+#include "pool.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * bench allocates its buffers from the heap on demand. An image built
+ * with MEMSTAT_HEAP_SIZE has a heap cut to the soak peak, which never
+ * included them, so bench is left out there as well as on the host.
+ */
+#if !defined(HOST_SIM) && !defined(MEMSTAT_HEAP_SIZE)
+#define SHELL_BENCH             1
+#include "bench.h"
+#else
+#define SHELL_BENCH             0
+#endif
+
+#define SHELL_MAX_ARGS          4
+
+/* portGET_RUN_TIME_COUNTER_VALUE() rate - CNTPCT / 256 */
+#define SHELL_RUN_TIME_HZ       (CPU_CNTPCT_HZ >> 8)
+
+typedef struct {
+    const char *name;
+    void (*run)(int argc, char **argv);
+    const char *help;
+} shell_cmd_t;
+
+/* ========== Helpers ========== */
+
+static int shell_streq(const char *a, const char *b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+/* Decimal or 0x-prefixed hex; returns 0 on junk or overflow */
+static int shell_parse_u32(const char *s, uint32_t *value) {
+    uint32_t base = 10;
+    uint64_t v = 0;
+
+    if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+        base = 16;
+        s += 2;
+    }
+    if (*s == '\0') {
+        return 0;
+    }
+
+    for (; *s; s++) {
+        uint32_t digit;
+        if (*s >= '0' && *s <= '9') {
+            digit = *s - '0';
+        } else if (base == 16 && *s >= 'a' && *s <= 'f') {
+            digit = *s - 'a' + 10;
+        } else if (base == 16 && *s >= 'A' && *s <= 'F') {
+            digit = *s - 'A' + 10;
+        } else {
+            return 0;
+        }
+        v = v * base + digit;
+        if (v > 0xFFFFFFFFu) {
+            return 0;
+        }
+    }
+    *value = (uint32_t)v;
+    return 1;
+}
+
+/* Left-aligned text column */
+static void shell_text(const char *s, uint32_t width) {
+    uint32_t n = 0;
+    for (; s[n]; n++) {
+        console_putc(s[n]);
+    }
+    for (; n < width; n++) {
+        console_putc(' ');
+    }
+}
+
+/* Right-aligned decimal column */
+static void shell_num(uint32_t v, uint32_t width) {
+    uint32_t digits = 1;
+    for (uint32_t t = v; t >= 10; t /= 10) {
+        digits++;
+    }
+    for (; digits < width; digits++) {
+        console_putc(' ');
+    }
+    console_printf("%u", v);
+}
+
+/* Per mille as a percentage with one decimal */
+static void shell_permille(uint32_t permille) {
+    console_printf("%u.%u%%", permille / 10, permille % 10);
+}
+
+/* CNTPCT ticks (52 ns) to nanoseconds */
+static uint32_t shell_ticks_to_ns(uint64_t ticks) {
+    return (uint32_t)(ticks * 625 / 12);
+}
+
+/* ========== ps ========== */
+
+static TaskStatus_t ps_status[SHELL_PS_MAX_TASKS];
+
+/* Run time counters at the previous ps, matched by task number */
+static struct {
+    UBaseType_t number;
+    uint32_t run_time;
+} ps_prev[SHELL_PS_MAX_TASKS];
+static uint32_t ps_prev_count;
+static uint32_t ps_prev_total;
+
+static const char *shell_state_name(eTaskState state) {
+    switch (state) {
+        case eRunning:   return "run";
+        case eReady:     return "ready";
+        case eBlocked:   return "blocked";
+        case eSuspended: return "suspend";
+        case eDeleted:   return "deleted";
+        default:         return "?";
+    }
+}
+
+static void cmd_ps(int argc, char **argv) {
+    uint32_t total;
+    UBaseType_t n = uxTaskGetSystemState(ps_status, SHELL_PS_MAX_TASKS, &total);
+
+    if (n == 0) {
+        console_printf("ps: more than %u tasks\n", SHELL_PS_MAX_TASKS);
+        return;
+    }
+
+    /* Unsigned deltas survive one counter wrap (15.9 hours) */
+    uint32_t elapsed = total - ps_prev_total;
+
+    shell_text("Task", configMAX_TASK_NAME_LEN + 1);
+    console_puts("State    Prio  Stack free   CPU\n");
+
+    for (UBaseType_t i = 0; i < n; i++) {
+        TaskStatus_t *t = &ps_status[i];
+        uint32_t prev = 0;
+
+        for (uint32_t j = 0; j < ps_prev_count; j++) {
+            if (ps_prev[j].number == t->xTaskNumber) {
+                prev = ps_prev[j].run_time;
+                break;
+            }
+        }
+        uint32_t permille = elapsed ? (uint32_t)((uint64_t)(t->ulRunTimeCounter - prev) * 1000 / elapsed) : 0;
+
+        shell_text(t->pcTaskName, configMAX_TASK_NAME_LEN + 1);
+        shell_text(shell_state_name(t->eCurrentState), 8);
+        shell_num(t->uxCurrentPriority, 2);
+        console_putc(t->uxCurrentPriority != t->uxBasePriority ? '*' : ' ');
+        shell_num(t->usStackHighWaterMark, 8);
+        console_puts(" words  ");
+        shell_permille(permille);
+        console_putc('\n');
+    }
+
+    for (UBaseType_t i = 0; i < n; i++) {
+        ps_prev[i].number = ps_status[i].xTaskNumber;
+        ps_prev[i].run_time = ps_status[i].ulRunTimeCounter;
+    }
+    ps_prev_count = n;
+    ps_prev_total = total;
+
+    console_printf("%u tasks, CPU over the last %u s (* = inherited priority)\n",
+                   (uint32_t)n, elapsed / SHELL_RUN_TIME_HZ);
+}
+
+/* ========== heap ========== */
+
+static void cmd_heap(int argc, char **argv) {
+    HeapStats_t hs;
+    vPortGetHeapStats(&hs);
+
+    uint32_t available = hs.xAvailableHeapSpaceInBytes;
+    uint32_t frag = available ?
+        1000 - (uint32_t)((uint64_t)hs.xSizeOfLargestFreeBlockInBytes * 1000 / available) : 0;
+
+    console_printf("Heap: %u of %u bytes free, minimum ever %u\n",
+                   available, (uint32_t)configTOTAL_HEAP_SIZE, (uint32_t)hs.xMinimumEverFreeBytesRemaining);
+    console_printf("  %u free blocks, largest %u, smallest %u, fragmentation ",
+                   (uint32_t)hs.xNumberOfFreeBlocks, (uint32_t)hs.xSizeOfLargestFreeBlockInBytes,
+                   (uint32_t)hs.xSizeOfSmallestFreeBlockInBytes);
+    shell_permille(frag);
+    console_printf("\n  %u allocations, %u frees\n",
+                   (uint32_t)hs.xNumberOfSuccessfulAllocations, (uint32_t)hs.xNumberOfSuccessfulFrees);
+
+    for (unsigned int c = 0; c < POOL_NUM_CLASSES; c++) {
+        pool_stats_t ps;
+        if (pool_get_stats(c, &ps)) {
+            console_printf("  pool %u B: %u/%u in use, peak %u, %u failures\n",
+                           ps.block_size, ps.in_use, ps.block_count, ps.peak, ps.failures);
+        }
+    }
+}
+
+/* ========== irq ========== */
+
+static const char *shell_irq_name(uint32_t source) {
+    switch (source) {
+        case BCM2837_IRQ_STATS_TICK: return "tick";
+        case IRQ_SYSTEM_TIMER_1:     return "systimer1";
+        case IRQ_SYSTEM_TIMER_3:     return "systimer3";
+        case IRQ_AUX:                return "aux";
+        case IRQ_GPIO_0:             return "gpio0";
+        case IRQ_GPIO_1:             return "gpio1";
+        case IRQ_GPIO_2:             return "gpio2";
+        case IRQ_GPIO_3:             return "gpio3";
+        case IRQ_I2C:                return "i2c";
+        case IRQ_SPI:                return "spi";
+        case IRQ_PCM:                return "pcm";
+        case IRQ_UART:               return "uart";
+        default:
+            return (source >= IRQ_DMA_0 && source <= IRQ_DMA_0 + 12) ? "dma" : "vc";
+    }
+}
+
+static void cmd_irq(int argc, char **argv) {
+    if (argc > 1 && shell_streq(argv[1], "reset")) {
+        bcm2837_irq_stats_reset();
+        console_puts("irq: statistics cleared\n");
+        return;
+    }
+
+    console_puts("Source        Count   Latency avg/max ns   Handler avg/max ns\n");
+    for (uint32_t src = 0; src < BCM2837_IRQ_STATS_COUNT; src++) {
+        bcm2837_irq_stats_t st;
+        if (!bcm2837_irq_get_stats(src, &st) || st.count == 0) {
+            continue;
+        }
+
+        shell_text(shell_irq_name(src), 10);
+        if (src == BCM2837_IRQ_STATS_TICK) {
+            console_puts("  ");
+        } else {
+            shell_num(src, 2);
+        }
+        shell_num(st.count, 10);
+        shell_num(shell_ticks_to_ns(st.latency_total / st.count), 11);
+        console_putc('/');
+        shell_num(shell_ticks_to_ns(st.latency_max), 8);
+        shell_num(shell_ticks_to_ns(st.run_total / st.count), 12);
+        console_putc('/');
+        shell_num(shell_ticks_to_ns(st.run_max), 8);
+        console_putc('\n');
+    }
+    console_printf("Console RX overflows: %u\n", console_rx_overflows());
+}
+
+/* ========== load ========== */
+
+static void cmd_load(int argc, char **argv) {
+    idle_stats_t s;
+    idle_get_stats(&s);
+
+    console_puts("CPU load: 1s ");
+    shell_permille(s.load_1s);
+    console_puts(", 10s ");
+    shell_permille(s.load_10s);
+    console_puts(", 60s ");
+    shell_permille(s.load_60s);
+    console_puts(" (background ");
+    shell_permille(s.job_permille);
+    console_printf(", %u s measured, %u wakeups)\n", s.history_s, s.wakeups);
+}
+
+/* ========== mem ========== */
+
+static void cmd_mem(int argc, char **argv) {
+    uint32_t addr, arg = 4;
+
+    if (argc < 3 || !shell_parse_u32(argv[2], &addr) ||
+        (argc > 3 && !shell_parse_u32(argv[3], &arg))) {
+        console_puts("usage: mem rd <addr> [words] | mem wr <addr> <value>\n");
+        return;
+    }
+    if (addr & 3) {
+        console_puts("mem: address must be word aligned\n");
+        return;
+    }
+
+    volatile uint32_t *p = (volatile uint32_t *)(uintptr_t)addr;
+
+    if (shell_streq(argv[1], "rd")) {
+        if (arg == 0 || arg > SHELL_MEM_MAX_WORDS) {
+            arg = SHELL_MEM_MAX_WORDS;
+        }
+        if (!mmu_addr_accessible(addr, arg * 4)) {
+            console_printf("mem: %x+%u not mapped or in a guard page\n", addr, arg * 4);
+            return;
+        }
+        for (uint32_t i = 0; i < arg; i++) {
+            if ((i & 3) == 0) {
+                console_printf("%s%x:", i ? "\n" : "", addr + i * 4);
+            }
+            console_printf(" %x", p[i]);
+        }
+        console_putc('\n');
+    } else if (shell_streq(argv[1], "wr") && argc > 3) {
+        if (!mmu_addr_accessible(addr, 4)) {
+            console_printf("mem: %x not mapped or in a guard page\n", addr);
+            return;
+        }
+        *p = arg;
+        console_printf("%x: wrote %x, read back %x\n", addr, arg, *p);
+    } else {
+        console_puts("usage: mem rd <addr> [words] | mem wr <addr> <value>\n");
+    }
+}
+
+/* ========== guard ========== */
+
+#if configUSE_STACK_GUARD
+/*
+ * Recurse until the shell task's stack runs into its guard page. The
+ * volatile frame keeps every level's locals on the stack and the
+ * compiler from turning the call into a loop; the depth bound is never
+ * reached, it only keeps the recursion visibly finite.
+ */
+static uint32_t shell_overrun(volatile uint32_t *caller) {
+    volatile uint32_t frame[64];
+
+    frame[0] = caller ? caller[0] + 1 : 0;
+    if (frame[0] > 0x100000) {
+        return 0;
+    }
+    return shell_overrun(frame) + frame[0];
+}
+
+/* The data abort report (trace.c) should name Shell, its guard page and the SP */
+static void cmd_guard(int argc, char **argv) {
+    if (argc < 2 || !shell_streq(argv[1], "overrun")) {
+        console_puts("usage: guard overrun  (faults the shell task - the board halts)\n");
+        return;
+    }
+    console_puts("guard: overrunning the Shell stack\n");
+    shell_overrun(NULL);
+}
+#endif
+
+/* ========== bench ========== */
+
+#if SHELL_BENCH
+static const struct {
+    const char *name;
+    void (*run)(void);
+} shell_benches[] = {
+    { "pool",    bench_pool },
+    { "ctx",     bench_context_switch },
+    { "fiq",     bench_fiq },
+    { "spi",     bench_spi },
+    { "dma",     bench_dma },
+    { "hrtimer", bench_hrtimer },
+    { "trace",   bench_trace },
+    { "msg",     bench_msg },
+};
+#endif
+
+static void cmd_bench(int argc, char **argv) {
+#if SHELL_BENCH
+    const uint32_t count = sizeof(shell_benches) / sizeof(shell_benches[0]);
+
+    if (argc < 2) {
+        console_puts("usage: bench all |");
+        for (uint32_t i = 0; i < count; i++) {
+            console_printf(" %s", shell_benches[i].name);
+        }
+        console_puts("\nBenchmarks spin the CPU and drive the peripherals - not for a live plant\n");
+        return;
+    }
+
+    if (shell_streq(argv[1], "all")) {
+        bench_run_all();
+        return;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (shell_streq(argv[1], shell_benches[i].name)) {
+            cpu_cycles_init();
+            shell_benches[i].run();
+            return;
+        }
+    }
+    console_printf("bench: no benchmark '%s'\n", argv[1]);
+#elif defined(HOST_SIM)
+    console_puts("bench: the benchmarks need the PMU and are not in the host build\n");
+#else
+    console_puts("bench: not in MEMSTAT_HEAP_SIZE images - the heap has no room for it\n");
+#endif
+}
+
+/* ========== sizes ========== */
+
+static void cmd_sizes(int argc, char **argv) {
+    memstat_sample();
+    memstat_report();
+}
+
+/* ========== Command Loop ========== */
+
+static void cmd_help(int argc, char **argv);
+
+static const shell_cmd_t shell_cmds[] = {
+    { "help",  cmd_help,  "this list" },
+    { "ps",    cmd_ps,    "tasks: state, priority, stack high-water mark, CPU" },
+    { "heap",  cmd_heap,  "heap free/minimum/fragmentation and pool classes" },
+    { "irq",   cmd_irq,   "[reset] per-source counts, latency and handler time" },
+    { "load",  cmd_load,  "rolling CPU load" },
+    { "mem",   cmd_mem,   "rd <addr> [words] | wr <addr> <value>" },
+    { "sizes", cmd_sizes, "stack/heap sizing report and memstat_sizes.h" },
+    { "bench", cmd_bench, "[name|all] run benchmarks (intrusive)" },
+#if configUSE_STACK_GUARD
+    { "guard", cmd_guard, "overrun the shell stack into its guard page (halts)" },
+#endif
+};
+
+#define SHELL_NUM_CMDS  (sizeof(shell_cmds) / sizeof(shell_cmds[0]))
+
+static void cmd_help(int argc, char **argv) {
+    for (uint32_t i = 0; i < SHELL_NUM_CMDS; i++) {
+        shell_text(shell_cmds[i].name, 7);
+        console_printf("%s\n", shell_cmds[i].help);
+    }
+}
+
+/* Split line in place on spaces and run the command */
+static void shell_execute(char *line) {
+    char *argv[SHELL_MAX_ARGS];
+    int argc = 0;
+
+    while (*line && argc < SHELL_MAX_ARGS) {
+        while (*line == ' ') {
+            *line++ = '\0';
+        }
+        if (*line == '\0') {
+            break;
+        }
+        argv[argc++] = line;
+        while (*line && *line != ' ') {
+            line++;
+        }
+    }
+    if (argc == 0) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < SHELL_NUM_CMDS; i++) {
+        if (shell_streq(argv[0], shell_cmds[i].name)) {
+            shell_cmds[i].run(argc, argv);
+            return;
+        }
+    }
+    console_printf("%s: unknown command (try help)\n", argv[0]);
+}
+
+/* The host terminal echoes stdin itself (cooked mode) */
+static void shell_echo(const char *s) {
+#ifndef HOST_SIM
+    console_puts(s);
+#else
+    (void)s;
+#endif
+}
+
+void vShellTask(void *pvParameters) {
+    char line[SHELL_LINE_MAX];
+    uint32_t len = 0;
+    char c, last = 0;
+
+    (void)pvParameters;
+    console_init(xTaskGetCurrentTaskHandle());
+    console_puts("\nDiagnostics shell ready - type help\n> ");
+
+    for (;;) {
+        console_wait();
+
+        while (console_getc(&c)) {
+            if (c == '\n' && last == '\r') {
+                /* Second half of a CR LF line end */
+            } else if (c == '\r' || c == '\n') {
+                shell_echo("\n");
+                line[len] = '\0';
+                shell_execute(line);
+                len = 0;
+                console_puts("> ");
+            } else if (c == '\b' || c == 0x7F) {
+                if (len > 0) {
+                    len--;
+                    shell_echo("\b \b");
+                }
+            } else if (c >= ' ' && c < 0x7F && len < SHELL_LINE_MAX - 1) {
+                char echo[2] = { c, '\0' };
+                line[len++] = c;
+                shell_echo(echo);
+            }
+            last = c;
+        }
+    }
+}
+
+#ifndef MEMSTAT_STACK_vShellTask
+#define MEMSTAT_STACK_vShellTask    (configMINIMAL_STACK_SIZE * 2)
+#endif
+
+APP_TASK(vShellTask, "Shell", MEMSTAT_STACK_vShellTask, SHELL_TASK_PRIORITY, 0);
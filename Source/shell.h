@@ -0,0 +1,50 @@
+/*
+ * Diagnostics Shell for RPi2 BCM2837
+ *
+ * Line-oriented commands on the UART0 console for looking inside a
+ * running system:
+ *
+ *   ps                     Task state, priority, stack high-water mark and
+ *                          CPU share since the previous ps (or since boot)
+ *   heap                   FreeRTOS heap free / minimum ever / fragmentation
+ *                          and the pool.h size classes
+ *   irq [reset]            Per-source interrupt counts, latency and handler
+ *                          time (configUSE_IRQ_STATS, bcm2837_irq.h)
+ *   load                   Rolling CPU load from the idle subsystem (idle.h)
+ *   mem rd <addr> [words]  Dump memory (word aligned, up to SHELL_MEM_MAX_WORDS)
+ *   mem wr <addr> <value>  Write one word and read it back
+ *   sizes                  Stack/heap right-sizing report with the
+ *                          memstat_sizes.h build input (memstat.h)
+ *   bench [name|all]       Run a bench.h benchmark - target only, intrusive
+ *
+ * The shell task runs at SHELL_TASK_PRIORITY, one above idle, and does
+ * all its I/O through console.h: it sleeps on the receive interrupt and
+ * yields while the TX FIFO is full, so it only ever uses time no
+ * real-time task wants. bench is the exception - the benchmarks create
+ * higher-priority tasks and drive the peripherals.
+ *
+ * mem takes raw physical addresses: a read of an unmapped peripheral
+ * window ends in a data abort (trace.h fault dump).
+ */
+
+#ifndef SHELL_H
+#define SHELL_H
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define SHELL_TASK_PRIORITY     ( tskIDLE_PRIORITY + 1 )
+
+/* Longest command line, including the terminator */
+#define SHELL_LINE_MAX          80
+
+/* Most words per mem rd */
+#define SHELL_MEM_MAX_WORDS     64
+
+/* Tasks ps can report (and remember run time for between calls) */
+#define SHELL_PS_MAX_TASKS      24
+
+/* The shell task itself - created by app_tasks_create_all() */
+void vShellTask(void *pvParameters);
+
+#endif /* SHELL_H */
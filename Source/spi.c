@@ -0,0 +1,316 @@
+/*
+ * SPI0 Master Driver for RPi2 BCM2837
+ * Transaction queue, FIFO interrupt path and DMA path
+ */
+
+#include "spi.h"
+#include "dma.h"
+#include "gpio.h"
+#include "bcm2837_irq.h"
+#include "cpu.h"
+#include "mmio.h"
+#include "placement.h"
+#include <stddef.h>
+
+/* SPI0 registers - pass to mmio_read()/mmio_write() */
+#define SPI0_BASE               0x3F204000
+#define SPI_CS                  (SPI0_BASE + 0x00)
+#define SPI_FIFO                (SPI0_BASE + 0x04)
+#define SPI_CLK                 (SPI0_BASE + 0x08)
+#define SPI_DLEN                (SPI0_BASE + 0x0C)
+
+/* CS register bits */
+#define SPI_CS_CPHA             (1u << 2)
+#define SPI_CS_CPOL             (1u << 3)
+#define SPI_CS_CLEAR_TX         (1u << 4)
+#define SPI_CS_CLEAR_RX         (1u << 5)
+#define SPI_CS_TA               (1u << 7)   /* Transfer active - asserts CS */
+#define SPI_CS_DMAEN            (1u << 8)
+#define SPI_CS_INTD             (1u << 9)   /* Interrupt on DONE */
+#define SPI_CS_INTR             (1u << 10)  /* Interrupt on RXR */
+#define SPI_CS_ADCS             (1u << 11)  /* Auto-deassert CS at the end of a DMA transfer */
+#define SPI_CS_DONE             (1u << 16)
+#define SPI_CS_RXD              (1u << 17)  /* RX FIFO not empty */
+#define SPI_CS_TXD              (1u << 18)  /* TX FIFO not full */
+
+/* Bytes in flight in FIFO mode - the RX FIFO must never overflow */
+#define SPI_FIFO_SIZE           64
+
+/* GPIO pins, all ALT0 */
+#define SPI_PIN_CE1             7
+#define SPI_PIN_CE0             8
+#define SPI_PIN_MISO            9
+#define SPI_PIN_MOSI            10
+#define SPI_PIN_SCLK            11
+
+/* Queue: spi_head is on the wire, records are linked through queue_next */
+static spi_xfer_t *spi_head;
+static spi_xfer_t *spi_tail;
+static int spi_cs_held;             /* Previous record ended with SPI_XFER_CS_KEEP */
+static int spi_head_dma;            /* spi_head is using the DMA path */
+
+static int spi_dma_tx = -1;
+static int spi_dma_rx = -1;
+static dma_cb_t spi_cb_tx;
+static dma_cb_t spi_cb_rx;
+static const uint32_t spi_zero = 0;
+
+static inline uint32_t spi_stamp(void) {
+    return (uint32_t)cpu_cntpct();
+}
+
+static uint32_t spi_cs_base(const spi_device_t *dev) {
+    uint32_t cs = dev->cs & 3;
+    if (dev->mode & 1) {
+        cs |= SPI_CS_CPHA;
+    }
+    if (dev->mode & 2) {
+        cs |= SPI_CS_CPOL;
+    }
+    return cs;
+}
+
+static int spi_use_dma(const spi_xfer_t *x) {
+    if (spi_dma_tx < 0 || spi_dma_rx < 0) {
+        return 0;
+    }
+    if (x->len < SPI_DMA_THRESHOLD || (x->len & 3)) {
+        return 0;
+    }
+    if (((uint32_t)x->tx | (uint32_t)x->rx) & 3) {
+        return 0;
+    }
+    /* Buffers the engine cannot address go through the FIFO instead */
+    if ((x->tx && !dma_ram_range(x->tx, x->len)) || (x->rx && !dma_ram_range(x->rx, x->len))) {
+        return 0;
+    }
+    if ((DMA_IS_LITE(spi_dma_tx) || DMA_IS_LITE(spi_dma_rx)) && x->len > DMA_LITE_MAX_LEN) {
+        return 0;
+    }
+    return 1;
+}
+
+/* ========== FIFO Path ========== */
+
+/* Drain RX, then top up TX without exceeding SPI_FIFO_SIZE bytes in flight */
+static void spi_fifo_pump(spi_xfer_t *x) {
+    while (x->rx_pos < x->len && (mmio_read(SPI_CS) & SPI_CS_RXD)) {
+        uint8_t b = (uint8_t)mmio_read(SPI_FIFO);
+        if (x->rx) {
+            x->rx[x->rx_pos] = b;
+        }
+        x->rx_pos++;
+    }
+
+    while (x->tx_pos < x->len && x->tx_pos - x->rx_pos < SPI_FIFO_SIZE &&
+           (mmio_read(SPI_CS) & SPI_CS_TXD)) {
+        mmio_write(SPI_FIFO, x->tx ? x->tx[x->tx_pos] : 0);
+        x->tx_pos++;
+    }
+}
+
+/* ========== Queue ========== */
+
+static void spi_dma_rx_done(int channel, int error, void *context);
+
+/* Put x on the wire - IRQs masked */
+static void spi_start(spi_xfer_t *x) {
+    uint32_t base = spi_cs_base(x->dev);
+
+    x->t_start = spi_stamp();
+    spi_head_dma = spi_use_dma(x);
+
+    if (!spi_cs_held) {
+        mmio_write(SPI_CLK, x->dev->clk_div);
+        mmio_write(SPI_CS, base | SPI_CS_CLEAR_TX | SPI_CS_CLEAR_RX);
+    }
+
+    if (spi_head_dma) {
+        spi_cb_rx.ti = DMA_TI_SRC_DREQ | DMA_TI_PERMAP(DMA_DREQ_SPI_RX) | DMA_TI_INTEN |
+                       (x->rx ? DMA_TI_DEST_INC : DMA_TI_DEST_IGNORE);
+        spi_cb_rx.source_ad = DMA_PERIPH_BUS(SPI_FIFO);
+        spi_cb_rx.dest_ad = x->rx ? dma_bus_addr(x->rx) : 0;
+        spi_cb_rx.txfr_len = x->len;
+        spi_cb_rx.stride = 0;
+        spi_cb_rx.nextconbk = 0;
+
+        spi_cb_tx.ti = DMA_TI_DEST_DREQ | DMA_TI_PERMAP(DMA_DREQ_SPI_TX) | DMA_TI_WAIT_RESP |
+                       (x->tx ? DMA_TI_SRC_INC : 0);
+        spi_cb_tx.source_ad = dma_bus_addr(x->tx ? (const void *)x->tx : (const void *)&spi_zero);
+        spi_cb_tx.dest_ad = DMA_PERIPH_BUS(SPI_FIFO);
+        spi_cb_tx.txfr_len = x->len;
+        spi_cb_tx.stride = 0;
+        spi_cb_tx.nextconbk = 0;
+
+        mmio_write(SPI_DLEN, x->len);
+        mmio_write(SPI_CS, base | SPI_CS_TA | SPI_CS_DMAEN |
+                           ((x->flags & SPI_XFER_CS_KEEP) ? 0 : SPI_CS_ADCS));
+
+        /* RX first so no received word is missed */
+        dma_start(spi_dma_rx, &spi_cb_rx, spi_dma_rx_done, NULL);
+        dma_start(spi_dma_tx, &spi_cb_tx, NULL, NULL);
+    } else {
+        mmio_write(SPI_CS, base | SPI_CS_TA | SPI_CS_INTR | SPI_CS_INTD);
+        spi_fifo_pump(x);
+    }
+}
+
+/* Retire spi_head and start the next record - IRQ context */
+HOT_FUNC static void spi_complete(int32_t status, BaseType_t *woken) {
+    spi_xfer_t *x = spi_head;
+    uint32_t base = spi_cs_base(x->dev);
+
+    if (x->flags & SPI_XFER_CS_KEEP) {
+        mmio_write(SPI_CS, base | SPI_CS_TA);  /* Stay selected, interrupts and DMA off */
+        spi_cs_held = 1;
+    } else {
+        mmio_write(SPI_CS, base);
+        spi_cs_held = 0;
+    }
+
+    spi_head = x->queue_next;
+    if (spi_head == NULL) {
+        spi_tail = NULL;
+    }
+
+    x->t_done = spi_stamp();
+    x->status = status;
+    if (x->done) {
+        x->done(x);
+    }
+    if (x->notify) {
+        vTaskNotifyGiveIndexedFromISR(x->notify, configDRIVER_NOTIFY_INDEX, woken);
+    }
+
+    if (spi_head) {
+        spi_start(spi_head);
+    }
+}
+
+HOT_FUNC static void spi_dma_rx_done(int channel, int error, void *context) {
+    BaseType_t woken = pdFALSE;
+
+    (void)channel;
+    (void)context;
+
+    if (spi_head == NULL || !spi_head_dma) {
+        return;
+    }
+    if (error) {
+        dma_abort(spi_dma_tx);
+    }
+    spi_complete(error ? SPI_XFER_ERROR : SPI_XFER_OK, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+HOT_FUNC static void spi_irq(void *context) {
+    BaseType_t woken = pdFALSE;
+    spi_xfer_t *x = spi_head;
+
+    (void)context;
+
+    if (x == NULL || spi_head_dma) {
+        mmio_modify(SPI_CS, SPI_CS_INTR | SPI_CS_INTD, 0);
+        return;
+    }
+
+    spi_fifo_pump(x);
+    if (x->rx_pos == x->len) {
+        spi_complete(SPI_XFER_OK, &woken);
+    }
+    portYIELD_FROM_ISR(woken);
+}
+
+void spi_submit(spi_xfer_t *batch) {
+    if (batch == NULL) {
+        return;
+    }
+
+    uint32_t stamp = spi_stamp();
+    spi_xfer_t *last = batch;
+    for (spi_xfer_t *x = batch; x; x = x->next) {
+        x->status = SPI_XFER_PENDING;
+        x->t_submit = stamp;
+        x->tx_pos = 0;
+        x->rx_pos = 0;
+        x->queue_next = x->next;
+        last = x;
+    }
+
+    uint32_t cpsr = cpu_irq_save();
+    if (spi_tail) {
+        spi_tail->queue_next = batch;
+        spi_tail = last;
+    } else {
+        spi_head = batch;
+        spi_tail = last;
+        spi_start(batch);
+    }
+    cpu_irq_restore(cpsr);
+}
+
+int spi_transfer(spi_xfer_t *batch, TickType_t timeout) {
+    if (batch == NULL) {
+        return SPI_XFER_OK;
+    }
+
+    spi_xfer_t *last = batch;
+    while (last->next) {
+        last = last->next;
+    }
+
+    /* The wait borrows last->notify - it may only already name this task */
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    TaskHandle_t caller = last->notify;
+    if (caller != NULL && caller != self) {
+        return SPI_XFER_INVALID;
+    }
+    last->notify = self;
+
+    ulTaskNotifyTakeIndexed(configDRIVER_NOTIFY_INDEX, pdTRUE, 0);    /* Drop a stale give */
+    spi_submit(batch);
+    if (ulTaskNotifyTakeIndexed(configDRIVER_NOTIFY_INDEX, pdTRUE, timeout) == 0) {
+        return SPI_XFER_TIMEOUT;     /* Still queued - notify stays until it completes */
+    }
+    last->notify = caller;
+
+    for (spi_xfer_t *x = batch; x; x = x->next) {
+        if (x->status != SPI_XFER_OK) {
+            return x->status;
+        }
+    }
+    return SPI_XFER_OK;
+}
+
+/* ========== Setup ========== */
+
+uint16_t spi_clk_div(uint32_t hz) {
+    uint32_t div = (SPI_CORE_CLOCK_HZ + hz - 1) / hz;
+
+    div = (div + 1) & ~1u;
+    if (div < 2) {
+        div = 2;
+    }
+    if (div > 65534) {
+        div = 65534;
+    }
+    return (uint16_t)div;
+}
+
+COLD_FUNC void spi_init(void) {
+    gpio_set_function(SPI_PIN_CE1, GPIO_FUNC_ALT0);
+    gpio_set_function(SPI_PIN_CE0, GPIO_FUNC_ALT0);
+    gpio_set_function(SPI_PIN_MISO, GPIO_FUNC_ALT0);
+    gpio_set_function(SPI_PIN_MOSI, GPIO_FUNC_ALT0);
+    gpio_set_function(SPI_PIN_SCLK, GPIO_FUNC_ALT0);
+
+    mmio_write(SPI_CS, SPI_CS_CLEAR_TX | SPI_CS_CLEAR_RX);
+    mmio_write(SPI_CLK, spi_clk_div(1000000));
+
+    /* Lite channels suffice (64 KB max); without both every transfer takes the FIFO path */
+    spi_dma_tx = dma_channel_alloc(DMA_CHAN_LITE);
+    spi_dma_rx = dma_channel_alloc(DMA_CHAN_LITE);
+
+    bcm2837_irq_register(IRQ_SPI, spi_irq, NULL);
+    bcm2837_enable_vc_irq(IRQ_SPI);
+}
@@ -0,0 +1,110 @@
+/*
+ * SPI0 Master Driver for RPi2 BCM2837
+ * Hardware chip selects CE0/CE1 on GPIO 8/7, MOSI/MISO/SCLK on GPIO 10/9/11
+ *
+ * Transfers are described by spi_xfer_t records linked through next and
+ * submitted as a batch, so a PLC scan can hand over all of its I/O for a
+ * cycle with one call. The driver runs the queue from interrupt context:
+ * short or unaligned transfers are fed through the FIFO by the SPI IRQ,
+ * long word-aligned ones go through two DMA channels (TX and RX) paced by
+ * the SPI DREQs. At most one transfer is on the wire at a time.
+ *
+ * Scatter-gather: SPI_XFER_CS_KEEP keeps the chip select asserted into the
+ * next record, so a chain of records forms a single device transaction.
+ *
+ * Every record carries CNTPCT stamps for submit, start and completion.
+ */
+
+#ifndef SPI_H
+#define SPI_H
+
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Transfers at least this long (and word aligned) use DMA */
+#define SPI_DMA_THRESHOLD       96
+
+/* Core clock feeding the SPI divider */
+#define SPI_CORE_CLOCK_HZ       250000000u
+
+/* spi_xfer_t.flags */
+#define SPI_XFER_CS_KEEP        (1 << 0)   /* Keep CS asserted into the next record */
+
+/* spi_xfer_t.status */
+#define SPI_XFER_OK             0
+#define SPI_XFER_PENDING        1
+#define SPI_XFER_ERROR          (-1)       /* DMA fault */
+#define SPI_XFER_TIMEOUT        (-2)       /* spi_transfer() gave up waiting */
+#define SPI_XFER_INVALID        (-3)       /* spi_transfer(): last record notifies another task */
+
+/* Per-device settings, usually one static const per remote I/O module */
+typedef struct {
+    uint8_t cs;             /* Chip select: 0 = CE0, 1 = CE1 */
+    uint8_t mode;           /* SPI mode 0-3 (CPOL << 1 | CPHA) */
+    uint16_t clk_div;       /* Core clock divider - even, see spi_clk_div() */
+} spi_device_t;
+
+typedef struct spi_xfer spi_xfer_t;
+
+/* Completion callback - IRQ context */
+typedef void (*spi_callback_t)(spi_xfer_t *xfer);
+
+struct spi_xfer {
+    spi_xfer_t *next;               /* Next record in the batch, NULL at the end */
+    const spi_device_t *dev;
+    const uint8_t *tx;              /* NULL sends zeros */
+    uint8_t *rx;                    /* NULL discards received data */
+    uint32_t len;
+    uint32_t flags;
+
+    spi_callback_t done;            /* Optional, called from the SPI/DMA IRQ */
+    void *context;
+    TaskHandle_t notify;            /* Optional, notified on configDRIVER_NOTIFY_INDEX */
+
+    volatile int32_t status;
+    uint32_t t_submit;              /* CNTPCT low words - see spi_xfer_latency_ticks() */
+    uint32_t t_start;
+    uint32_t t_done;
+
+    /* Driver private */
+    spi_xfer_t *queue_next;
+    uint32_t tx_pos;
+    uint32_t rx_pos;
+};
+
+/* Route the pins, claim two DMA channels and register IRQ_SPI - call after dma_init() */
+void spi_init(void);
+
+/* Even divider giving at most hz */
+uint16_t spi_clk_div(uint32_t hz);
+
+/*
+ * Queue a batch of records (linked through next) behind anything already
+ * pending and return immediately. Records must stay valid until their
+ * status leaves SPI_XFER_PENDING.
+ */
+void spi_submit(spi_xfer_t *batch);
+
+/*
+ * Blocking submit: waits until the last record of the batch completes.
+ * Returns SPI_XFER_OK, the first record error, or SPI_XFER_TIMEOUT (the
+ * batch then stays queued and must not be reused until it completes).
+ *
+ * The wait uses the last record's notify field: it must be NULL or the
+ * calling task, else SPI_XFER_INVALID is returned and nothing is queued.
+ * The caller's value is put back on completion; after a timeout it stays
+ * the calling task until the batch completes.
+ */
+int spi_transfer(spi_xfer_t *batch, TickType_t timeout);
+
+/* Submit-to-completion time, and the part of it spent waiting in the queue */
+static inline uint32_t spi_xfer_latency_ticks(const spi_xfer_t *xfer) {
+    return xfer->t_done - xfer->t_submit;
+}
+
+static inline uint32_t spi_xfer_queue_ticks(const spi_xfer_t *xfer) {
+    return xfer->t_start - xfer->t_submit;
+}
+
+#endif /* SPI_H */
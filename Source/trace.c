@@ -0,0 +1,103 @@
+/*
+ * Flight Recorder for RPi2 BCM2837
+ * Ring setup, UART dump and the abort report
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "trace.h"
+#include "uart.h"
+#include "placement.h"
+#if configUSE_STACK_GUARD
+#include "mmu.h"
+#endif
+#include <stddef.h>
+#ifdef HOST_SIM
+#include <stdlib.h>
+#endif
+
+/* Not cleared at boot - see .noinit in link_rpi2.ld */
+trace_buffer_t trace_buffer __attribute__((section(".noinit"), aligned(64)));
+
+volatile uint32_t trace_fault_sp;
+
+static const char *const trace_fault_names[] = { "?", "undefined instruction", "prefetch abort", "data abort" };
+
+COLD_FUNC void trace_init(void) {
+    if (trace_buffer.magic != TRACE_MAGIC || trace_buffer.ring_size != TRACE_RING_SIZE) {
+        /* Power-on: RAM content is random */
+        trace_buffer.magic = TRACE_MAGIC;
+        trace_buffer.ring_size = TRACE_RING_SIZE;
+        trace_buffer.boot_count = 0;
+        trace_buffer.fault_pending = 0;
+        trace_buffer.head = 0;
+    } else {
+        trace_buffer.boot_count++;
+        uart_printf("Flight recorder: boot %u, %u records kept\n", trace_buffer.boot_count,
+                    trace_buffer.head < TRACE_RING_SIZE ? trace_buffer.head : TRACE_RING_SIZE);
+    }
+
+    if (trace_buffer.fault_pending) {
+        uart_puts("Previous boot faulted - flight recorder follows\r\n");
+        trace_dump();
+        trace_buffer.fault_pending = 0;
+    }
+
+    trace_event(TRACE_EV_BOOT, 0, trace_buffer.boot_count, 0);
+}
+
+COLD_FUNC void trace_dump(void) {
+    uint32_t head = trace_buffer.head;
+    uint32_t count = head < TRACE_RING_SIZE ? head : TRACE_RING_SIZE;
+
+    uart_printf("TRACE BEGIN %u %u %u\n", trace_buffer.boot_count, head, count);
+    for (uint32_t i = head - count; i != head; i++) {
+        const trace_record_t *r = &trace_buffer.ring[i & (TRACE_RING_SIZE - 1)];
+        uart_printf("T %x %x %x %x\n", r->stamp, ((uint32_t)r->event << 16) | r->aux, r->a, r->b);
+    }
+    uart_puts("TRACE END\r\n");
+}
+
+void trace_task_create(uint32_t number, const char *name) {
+    uint32_t packed[2] = { 0, 0 };
+
+    for (int i = 0; i < 8 && name[i]; i++) {
+        packed[i / 4] |= (uint32_t)(uint8_t)name[i] << ((i % 4) * 8);
+    }
+    trace_event(TRACE_EV_TASK_CREATE, number, packed[0], packed[1]);
+}
+
+/*
+ * Runs on the abort or undefined mode stack with IRQs masked. The ring is
+ * marked so the next boot dumps it again in case this UART output is lost.
+ */
+COLD_FUNC void trace_fault(uint32_t type, uint32_t pc, uint32_t fault_addr, uint32_t fault_status) {
+    trace_event(TRACE_EV_FAULT, type, pc, fault_addr);
+    trace_buffer.fault_pending = 1;
+
+    uart_printf("\n*** FAULT: %s at pc %x, address %x, status %x, sp %x\n",
+                trace_fault_names[type <= TRACE_FAULT_DATA ? type : 0], pc, fault_addr, fault_status,
+                trace_fault_sp);
+    if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING) {
+        uart_printf("*** current task: %s\n", pcTaskGetName(NULL));
+    }
+
+#if configUSE_STACK_GUARD
+    /* A data abort on a guard page is a stack overrun (mmu.h) */
+    const char *owner = type == TRACE_FAULT_DATA ? mmu_guard_owner(fault_addr) : NULL;
+    if (owner) {
+        trace_event(TRACE_EV_STACK_OVERFLOW, 0, (uint32_t)(uintptr_t)xTaskGetCurrentTaskHandle(), trace_fault_sp);
+        uart_printf("*** STACK OVERFLOW: %s ran into its guard page at %x (sp %x)\n",
+                    owner, fault_addr & ~(MMU_PAGE_SIZE - 1), trace_fault_sp);
+    }
+#endif
+    trace_dump();
+
+#ifdef HOST_SIM
+    abort();
+#else
+    for (;;) {
+        __asm volatile("wfi");
+    }
+#endif
+}
@@ -0,0 +1,162 @@
+/*
+ * Flight Recorder for RPi2 BCM2837
+ *
+ * Fixed-size ring of 16-byte timestamped records in the .noinit section,
+ * which the BSS clear skips, so the last TRACE_RING_SIZE events survive a
+ * crash or a warm reset. Records come from the FreeRTOS trace macros
+ * defined below (task switches, task creation, queue/semaphore/mutex
+ * traffic), from vApplicationIRQHandler (ISR entry/exit), from the assert
+ * and stack overflow hooks, and from the abort handlers in startup_rpi2.S.
+ *
+ * Writing a record is one CNTPCT read and four stores with IRQs masked.
+ * trace_dump() prints the ring on UART0 and tools/trace_decode.py turns
+ * the dump (or a raw memory image of trace_buffer) into a timeline.
+ *
+ * Set configUSE_FLIGHT_RECORDER to 0 in FreeRTOSConfig.h to compile all
+ * hooks out.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+/* Fault codes passed to trace_fault() - shared with startup_rpi2.S */
+#define TRACE_FAULT_UNDEFINED       1
+#define TRACE_FAULT_PREFETCH        2
+#define TRACE_FAULT_DATA            3
+
+#ifndef __ASSEMBLER__
+
+#include <stdint.h>
+#include "cpu.h"
+
+/* Records in the ring - power of two */
+#define TRACE_RING_SIZE             1024
+
+#define TRACE_MAGIC                 0x31435254  /* "TRC1" */
+
+/* Event codes - keep in sync with tools/trace_decode.py */
+#define TRACE_EV_BOOT               1   /* a = boot count */
+#define TRACE_EV_TASK_CREATE        2   /* aux = task number, a/b = first 8 name bytes */
+#define TRACE_EV_SWITCH_IN          3   /* aux = task number, a = TCB */
+#define TRACE_EV_SWITCH_OUT         4   /* aux = task number, a = TCB */
+#define TRACE_EV_ISR_ENTER          5   /* a = core 0 pending sources */
+#define TRACE_EV_ISR_EXIT           6
+#define TRACE_EV_QUEUE_SEND         7   /* aux = queue type, a = queue, b = items after */
+#define TRACE_EV_QUEUE_SEND_FAILED  8
+#define TRACE_EV_QUEUE_RECEIVE      9
+#define TRACE_EV_QUEUE_RECV_FAILED  10
+#define TRACE_EV_QUEUE_BLOCK_SEND   11
+#define TRACE_EV_QUEUE_BLOCK_RECV   12
+#define TRACE_EV_QUEUE_SEND_ISR     13
+#define TRACE_EV_QUEUE_RECV_ISR     14
+#define TRACE_EV_ASSERT             15  /* a = line, b = file name pointer */
+#define TRACE_EV_STACK_OVERFLOW     16  /* a = task handle, b = SP if caught by a guard page */
+#define TRACE_EV_MALLOC_FAILED      17
+#define TRACE_EV_FAULT              18  /* aux = TRACE_FAULT_*, a = PC, b = fault address */
+#define TRACE_EV_USER               32  /* First application-defined code */
+
+typedef struct {
+    uint32_t stamp;             /* CNTPCT low word (52 ns units) */
+    uint16_t event;
+    uint16_t aux;
+    uint32_t a;
+    uint32_t b;
+} trace_record_t;
+
+/* Layout is read by tools/trace_decode.py - append fields only */
+typedef struct {
+    uint32_t magic;
+    uint32_t ring_size;
+    uint32_t boot_count;
+    uint32_t fault_pending;     /* Set by trace_fault(), dumped on the next boot */
+    volatile uint32_t head;     /* Records ever written; slot = head % ring_size */
+    uint32_t reserved[3];
+    trace_record_t ring[TRACE_RING_SIZE];
+} trace_buffer_t;
+
+extern trace_buffer_t trace_buffer;
+
+/* Append one record - any context except FIQ */
+static inline void trace_event(uint32_t event, uint32_t aux, uint32_t a, uint32_t b) {
+    uint32_t lo, hi;
+    uint32_t cpsr = cpu_irq_save();
+
+    uint32_t head = trace_buffer.head;
+    trace_record_t *r = &trace_buffer.ring[head & (TRACE_RING_SIZE - 1)];
+
+#ifndef HOST_SIM
+    /* No isb: ordering against neighbouring events is all that matters */
+    __asm volatile("mrrc p15, 0, %0, %1, c14" : "=r" (lo), "=r" (hi));
+    (void)hi;
+#else
+    lo = (uint32_t)cpu_cntpct();
+    (void)hi;
+#endif
+
+    r->stamp = lo;
+    r->event = (uint16_t)event;
+    r->aux = (uint16_t)aux;
+    r->a = a;
+    r->b = b;
+    trace_buffer.head = head + 1;
+
+    cpu_irq_restore(cpsr);
+}
+
+/* Validate or reset the ring, count the boot, dump it if the last boot faulted */
+void trace_init(void);
+
+/* Print the ring on UART0, oldest first, in the format trace_decode.py reads */
+void trace_dump(void);
+
+/* Record a task name for the decoder (traceTASK_CREATE) */
+void trace_task_create(uint32_t number, const char *name);
+
+/* SP of the mode that faulted - stored by startup_rpi2.S before trace_fault() */
+extern volatile uint32_t trace_fault_sp;
+
+/* Abort entry from startup_rpi2.S: record, report, dump and hang */
+void trace_fault(uint32_t type, uint32_t pc, uint32_t fault_addr, uint32_t fault_status)
+    __attribute__((noreturn));
+
+/* ========== FreeRTOS Hooks ========== */
+
+#if configUSE_FLIGHT_RECORDER
+
+/* Combined with the lazy FPU hook in FreeRTOSConfig.h */
+#define TRACE_TASK_SWITCHED_IN() \
+    trace_event(TRACE_EV_SWITCH_IN, pxCurrentTCB->uxTCBNumber, (uint32_t)(uintptr_t)pxCurrentTCB, 0)
+
+#define traceTASK_SWITCHED_OUT() \
+    trace_event(TRACE_EV_SWITCH_OUT, pxCurrentTCB->uxTCBNumber, (uint32_t)(uintptr_t)pxCurrentTCB, 0)
+
+#define traceTASK_CREATE(pxNewTCB) \
+    trace_task_create((pxNewTCB)->uxTCBNumber, (pxNewTCB)->pcTaskName)
+
+#define TRACE_QUEUE_EVENT(ev, pxQueue) \
+    trace_event((ev), (pxQueue)->ucQueueType, (uint32_t)(uintptr_t)(pxQueue), (pxQueue)->uxMessagesWaiting)
+
+#define traceQUEUE_SEND(pxQueue)                TRACE_QUEUE_EVENT(TRACE_EV_QUEUE_SEND, pxQueue)
+#define traceQUEUE_SEND_FAILED(pxQueue)         TRACE_QUEUE_EVENT(TRACE_EV_QUEUE_SEND_FAILED, pxQueue)
+#define traceQUEUE_RECEIVE(pxQueue)             TRACE_QUEUE_EVENT(TRACE_EV_QUEUE_RECEIVE, pxQueue)
+#define traceQUEUE_RECEIVE_FAILED(pxQueue)      TRACE_QUEUE_EVENT(TRACE_EV_QUEUE_RECV_FAILED, pxQueue)
+#define traceBLOCKING_ON_QUEUE_SEND(pxQueue)    TRACE_QUEUE_EVENT(TRACE_EV_QUEUE_BLOCK_SEND, pxQueue)
+#define traceBLOCKING_ON_QUEUE_RECEIVE(pxQueue) TRACE_QUEUE_EVENT(TRACE_EV_QUEUE_BLOCK_RECV, pxQueue)
+#define traceQUEUE_SEND_FROM_ISR(pxQueue)       TRACE_QUEUE_EVENT(TRACE_EV_QUEUE_SEND_ISR, pxQueue)
+#define traceQUEUE_RECEIVE_FROM_ISR(pxQueue)    TRACE_QUEUE_EVENT(TRACE_EV_QUEUE_RECV_ISR, pxQueue)
+
+/* Application-side hooks */
+#define TRACE_ISR_ENTER(pending)    trace_event(TRACE_EV_ISR_ENTER, 0, (pending), 0)
+#define TRACE_ISR_EXIT()            trace_event(TRACE_EV_ISR_EXIT, 0, 0, 0)
+
+#else
+
+#define TRACE_TASK_SWITCHED_IN()
+#define TRACE_ISR_ENTER(pending)
+#define TRACE_ISR_EXIT()
+
+#endif /* configUSE_FLIGHT_RECORDER */
+
+#endif /* __ASSEMBLER__ */
+
+#endif /* TRACE_H */
@@ -4,18 +4,83 @@
  */
 
 #include "uart.h"
+#include "mmio.h"
 #include <stdarg.h>
+#ifdef HOST_SIM
+#include "cpu.h"
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef HOST_SIM
+
+/* ========== Host Simulation ========== */
+/*
+ * stdout/stdin stand in for UART0. '\r' is dropped so logs diff cleanly;
+ * the formatting layered on uart_putc() is shared with the target.
+ */
+
+void uart_init(void) {
+    setvbuf(stdout, NULL, _IONBF, 0);
+}
+
+/*
+ * The POSIX port switches tasks from its SIGALRM handler. A task switched
+ * out inside putchar() keeps the stdout lock, and a higher-priority task
+ * that prints next blocks on it for good - so stdout is only touched with
+ * the tick masked.
+ */
+void uart_putc(char c) {
+    if (c != '\r') {
+        uint32_t masked = cpu_irq_save();
+        putchar(c);
+        cpu_irq_restore(masked);
+    }
+}
+
+char uart_getc(void) {
+    int c = getchar();
+    return c == EOF ? 0 : (char)c;
+}
+
+int uart_try_putc(char c) {
+    uart_putc(c);
+    return 1;
+}
+
+/* stdin is switched to non-blocking reads by uart_rx_irq_enable() */
+int uart_try_getc(char *c) {
+    return read(STDIN_FILENO, c, 1) == 1;
+}
+
+/* No receive interrupt on the host - readers poll uart_try_getc() */
+void uart_rx_irq_enable(int enable) {
+    int flags = fcntl(STDIN_FILENO, F_GETFL);
+    fcntl(STDIN_FILENO, F_SETFL, enable ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
+}
+
+void uart_rx_irq_ack(void) {
+}
+
+#else
 
 /* PL011 UART0 registers - BCM2837 uses 0x3F000000 peripheral base */
 #define UART0_BASE      0x3F201000
 
-#define UART0_DR        (*(volatile uint32_t *)(UART0_BASE + 0x00))  /* Data register */
-#define UART0_FR        (*(volatile uint32_t *)(UART0_BASE + 0x18))  /* Flag register */
-#define UART0_IBRD      (*(volatile uint32_t *)(UART0_BASE + 0x24))  /* Integer baud rate */
-#define UART0_FBRD      (*(volatile uint32_t *)(UART0_BASE + 0x28))  /* Fractional baud rate */
-#define UART0_LCRH      (*(volatile uint32_t *)(UART0_BASE + 0x2C))  /* Line control */
-#define UART0_CR        (*(volatile uint32_t *)(UART0_BASE + 0x30))  /* Control register */
-#define UART0_ICR       (*(volatile uint32_t *)(UART0_BASE + 0x44))  /* Interrupt clear */
+/* Register offsets from UART0_BASE */
+#define UART0_DR        0x00    /* Data register */
+#define UART0_FR        0x18    /* Flag register */
+#define UART0_IBRD      0x24    /* Integer baud rate */
+#define UART0_FBRD      0x28    /* Fractional baud rate */
+#define UART0_LCRH      0x2C    /* Line control */
+#define UART0_IFLS      0x34    /* Interrupt FIFO level select */
+#define UART0_CR        0x30    /* Control register */
+#define UART0_IMSC      0x38    /* Interrupt mask set/clear */
+#define UART0_ICR       0x44    /* Interrupt clear */
+
+#define UART0_REG(offset)           mmio_read(UART0_BASE + (offset))
+#define UART0_WRITE(offset, value)  mmio_write(UART0_BASE + (offset), (value))
 
 /* Flag register bits */
 #define UART_FR_TXFF    (1 << 5)  /* Transmit FIFO full */
@@ -26,74 +91,129 @@
 #define UART_CR_TXE     (1 << 8)  /* Transmit enable */
 #define UART_CR_RXE     (1 << 9)  /* Receive enable */
 
-/* Line control bits */
-#define UART_LCRH_WLEN_8BIT  (3 << 5)  /* 8-bit word length */
-#define UART_LCRH_FEN        (1 << 4)  /* Enable FIFOs */
+/* Interrupt mask/clear bits (IMSC, ICR) */
+#define UART_INT_RX     (1 << 4)  /* Receive FIFO at IFLS level */
+#define UART_INT_RT     (1 << 6)  /* Receive timeout - FIFO not empty and idle for 32 bits */
+
+/* Fields - see mmio.h */
+#define UART_DR_DATA        MMIO_FIELD(0, 8)
+#define UART_IBRD_DIVISOR   MMIO_FIELD(0, 16)
+#define UART_FBRD_DIVISOR   MMIO_FIELD(0, 6)
+#define UART_LCRH_WLEN      MMIO_FIELD(5, 2)    /* Word length - 5 + value bits */
+#define UART_LCRH_FEN       (1 << 4)  /* Enable FIFOs */
+#define UART_IFLS_RX        MMIO_FIELD(3, 3)    /* Receive interrupt level - 0 is 1/8 full */
 
 void uart_init(void) {
     /* Disable UART */
-    UART0_CR = 0;
+    UART0_WRITE(UART0_CR, 0);
 
     /* Clear all interrupts */
-    UART0_ICR = 0x7FF;
+    UART0_WRITE(UART0_ICR, 0x7FF);
 
     /* Set baud rate to 115200 */
     /* UART clock = 48MHz (Pi 2B default PL011 clock)
      * Divisor = 48000000 / (16 * 115200) = 26.0416...
      * Integer part: 26, Fractional part: 0.0416... * 64 = 2.66 ≈ 3
      */
-    UART0_IBRD = 26;
-    UART0_FBRD = 3;
+    UART0_WRITE(UART0_IBRD, MMIO_PREP(UART_IBRD_DIVISOR, 26));
+    UART0_WRITE(UART0_FBRD, MMIO_PREP(UART_FBRD_DIVISOR, 3));
 
     /* 8-bit, no parity, 1 stop bit, FIFOs enabled */
-    UART0_LCRH = UART_LCRH_WLEN_8BIT | UART_LCRH_FEN;
+    UART0_WRITE(UART0_LCRH, MMIO_PREP(UART_LCRH_WLEN, 3) | UART_LCRH_FEN);
 
     /* Enable UART, TX, and RX */
-    UART0_CR = UART_CR_UARTEN | UART_CR_TXE | UART_CR_RXE;
+    UART0_WRITE(UART0_CR, UART_CR_UARTEN | UART_CR_TXE | UART_CR_RXE);
 }
 
 void uart_putc(char c) {
     /* Wait until TX FIFO is not full */
-    while (UART0_FR & UART_FR_TXFF);
+    while (UART0_REG(UART0_FR) & UART_FR_TXFF);
 
     /* Write character */
-    UART0_DR = (uint32_t)c;
+    UART0_WRITE(UART0_DR, (uint8_t)c);
 
     /* Convert \n to \r\n for proper terminal output */
     if (c == '\n') {
-        while (UART0_FR & UART_FR_TXFF);
-        UART0_DR = '\r';
+        while (UART0_REG(UART0_FR) & UART_FR_TXFF);
+        UART0_WRITE(UART0_DR, '\r');
     }
 }
 
 char uart_getc(void) {
     /* Wait until RX FIFO has data */
-    while (UART0_FR & UART_FR_RXFE);
+    while (UART0_REG(UART0_FR) & UART_FR_RXFE);
+
+    /* Read character - the upper bits are receive error flags */
+    return (char)MMIO_GET(UART_DR_DATA, UART0_REG(UART0_DR));
+}
 
-    /* Read character */
-    return (char)(UART0_DR & 0xFF);
+int uart_try_putc(char c) {
+    if (UART0_REG(UART0_FR) & UART_FR_TXFF) {
+        return 0;
+    }
+    UART0_WRITE(UART0_DR, (uint8_t)c);
+    return 1;
 }
 
+int uart_try_getc(char *c) {
+    if (UART0_REG(UART0_FR) & UART_FR_RXFE) {
+        return 0;
+    }
+    *c = (char)MMIO_GET(UART_DR_DATA, UART0_REG(UART0_DR));
+    return 1;
+}
+
+/*
+ * Receive interrupt (VideoCore IRQ 57): the level interrupt fires at 1/8
+ * full (2 bytes) and the timeout catches a lone keystroke 32 bit times
+ * after it arrives.
+ */
+void uart_rx_irq_enable(int enable) {
+    UART0_WRITE(UART0_IFLS, MMIO_PREP(UART_IFLS_RX, 0));
+    UART0_WRITE(UART0_ICR, UART_INT_RX | UART_INT_RT);
+    UART0_WRITE(UART0_IMSC, enable ? (UART_INT_RX | UART_INT_RT) : 0);
+}
+
+/* Clear the receive interrupts once the FIFO has been drained */
+void uart_rx_irq_ack(void) {
+    UART0_WRITE(UART0_ICR, UART_INT_RX | UART_INT_RT);
+}
+
+#endif /* HOST_SIM */
+
 void uart_puts(const char *s) {
     while (*s) {
         uart_putc(*s++);
     }
 }
 
-void uart_hex(uint32_t val) {
-    uart_puts("0x");
+/* ========== Formatting ========== */
+/*
+ * Shared by uart_printf() and the writers layered on other sinks
+ * (console.h) - the sink decides whether a full TX FIFO spins or blocks.
+ */
+
+static void uart_out_puts(uart_out_t out, const char *s) {
+    while (*s) {
+        out(*s++);
+    }
+}
+
+static void uart_out_hex(uart_out_t out, uint32_t val) {
+    out('0');
+    out('x');
     for (int i = 28; i >= 0; i -= 4) {
         int digit = (val >> i) & 0xF;
-        uart_putc(digit < 10 ? '0' + digit : 'A' + digit - 10);
+        out(digit < 10 ? '0' + digit : 'A' + digit - 10);
     }
 }
 
-void uart_decimal(uint32_t val) {
+static void uart_out_decimal(uart_out_t out, uint32_t val) {
     char buffer[12];
     int i = 0;
 
     if (val == 0) {
-        uart_putc('0');
+        out('0');
         return;
     }
 
@@ -104,63 +224,75 @@ void uart_decimal(uint32_t val) {
 
     /* Print in reverse order */
     while (i > 0) {
-        uart_putc(buffer[--i]);
+        out(buffer[--i]);
     }
 }
 
-/* Simple printf implementation supporting %s, %d, %x, %c */
-int uart_printf(const char *format, ...) {
-    va_list args;
-    va_start(args, format);
+void uart_hex(uint32_t val) {
+    uart_out_hex(uart_putc, val);
+}
 
+void uart_decimal(uint32_t val) {
+    uart_out_decimal(uart_putc, val);
+}
+
+/* Simple printf implementation supporting %s, %d, %u, %x, %c */
+int uart_vprintf(uart_out_t out, const char *format, va_list args) {
     while (*format) {
         if (*format == '%') {
             format++;
             switch (*format) {
                 case 's': {
                     const char *s = va_arg(args, const char *);
-                    uart_puts(s ? s : "(null)");
+                    uart_out_puts(out, s ? s : "(null)");
                     break;
                 }
                 case 'd': {
                     int val = va_arg(args, int);
                     if (val < 0) {
-                        uart_putc('-');
+                        out('-');
                         val = -val;
                     }
-                    uart_decimal((uint32_t)val);
+                    uart_out_decimal(out, (uint32_t)val);
                     break;
                 }
                 case 'u': {
                     uint32_t val = va_arg(args, uint32_t);
-                    uart_decimal(val);
+                    uart_out_decimal(out, val);
                     break;
                 }
                 case 'x': {
                     uint32_t val = va_arg(args, uint32_t);
-                    uart_hex(val);
+                    uart_out_hex(out, val);
                     break;
                 }
                 case 'c': {
                     char c = (char)va_arg(args, int);
-                    uart_putc(c);
+                    out(c);
                     break;
                 }
                 case '%': {
-                    uart_putc('%');
+                    out('%');
                     break;
                 }
                 default:
-                    uart_putc('%');
-                    uart_putc(*format);
+                    out('%');
+                    out(*format);
                     break;
             }
         } else {
-            uart_putc(*format);
+            out(*format);
         }
         format++;
     }
 
+    return 0;
+}
+
+int uart_printf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    uart_vprintf(uart_putc, format, args);
     va_end(args);
     return 0;
 }
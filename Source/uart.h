@@ -8,15 +8,27 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdarg.h>
 
 /* Initialize UART */
 void uart_init(void);
 
-/* Basic character I/O */
+/* Basic character I/O - spin on the FIFO */
 void uart_putc(char c);
 char uart_getc(void);
 void uart_puts(const char *s);
 
+/*
+ * Non-blocking character I/O - return 1 if the byte moved, 0 if the TX
+ * FIFO is full / the RX FIFO is empty. No '\n' translation.
+ */
+int uart_try_putc(char c);
+int uart_try_getc(char *c);
+
+/* Receive interrupt (IRQ_UART) mask in the PL011; the handler is the caller's (console.c) */
+void uart_rx_irq_enable(int enable);
+void uart_rx_irq_ack(void);
+
 /* Formatted output */
 void uart_hex(uint32_t val);
 void uart_decimal(uint32_t val);
@@ -24,4 +36,8 @@ void uart_decimal(uint32_t val);
 /* Printf-style output (simple version) */
 int uart_printf(const char *format, ...);
 
+/* Same formatting to any character sink (e.g. console_putc) */
+typedef void (*uart_out_t)(char c);
+int uart_vprintf(uart_out_t out, const char *format, va_list args);
+
 #endif /* UART_H */
@@ -0,0 +1,6 @@
+#!/bin/bash
+# Benchmark image build - the full FreeRTOS build with Source/main_bench.c
+# as the entry point instead of Source/main.c
+set -e
+
+APP_MAIN=main_bench.c exec ./build_rpi2.sh
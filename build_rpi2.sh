@@ -16,6 +16,7 @@ APP_SRC="Source"
 BUILD_DIR="Build"
 STARTUP_DIR="Startup"
 OUTPUT="kernel7.img"
+APP_MAIN="${APP_MAIN:-main.c}"  # Entry point, e.g. APP_MAIN=main_bench.c
 
 # Check if FreeRTOS kernel exists
 if [ ! -d "$FREERTOS_KERNEL" ]; then
@@ -45,8 +46,49 @@ rm -f *.o *.elf *.img
 CFLAGS="-mcpu=cortex-a53 -mfpu=neon-fp-armv8 -mfloat-abi=hard -marm"
 CFLAGS="$CFLAGS -nostdlib -ffreestanding -O2 -Wall"
 CFLAGS="$CFLAGS -I../$APP_SRC -I../$FREERTOS_KERNEL/include -I../$FREERTOS_PORT"
+# One input section per function/variable, so link_rpi2.ld can pull the
+# kernel's hot paths into .text.hot / .data.hot by name (Source/placement.h)
+CFLAGS="$CFLAGS -ffunction-sections -fdata-sections"
 
-ASFLAGS="-mcpu=cortex-a53 -mfpu=neon-fp-armv8 -mfloat-abi=hard"
+ASFLAGS="-mcpu=cortex-a53 -mfpu=neon-fp-armv8 -mfloat-abi=hard -I../$APP_SRC"
+
+# FAST_BOOT=1: no startup delay, boot breadcrumbs go to RAM (boot_marks) not UART
+if [ "${FAST_BOOT:-0}" = "1" ]; then
+    echo "Fast boot enabled"
+    CFLAGS="$CFLAGS -DFAST_BOOT"
+    ASFLAGS="$ASFLAGS -DFAST_BOOT"
+fi
+
+# PRODUCTION=1: drop the per-switch stack pattern scan, relying on the MMU
+# guard pages below the static task stacks (see Source/mmu.h)
+if [ "${PRODUCTION:-0}" = "1" ]; then
+    echo "Production build"
+    CFLAGS="$CFLAGS -DPRODUCTION_BUILD"
+fi
+
+# MEMSTAT_SIZES=<file>: stack depths and heap size from a memstat report,
+# cut out of a UART log by tools/memstat_sizes.py (see Source/memstat.h)
+if [ -n "${MEMSTAT_SIZES:-}" ]; then
+    MEMSTAT_SIZES="$(cd .. && realpath "$MEMSTAT_SIZES")"
+    echo "Sizes from $MEMSTAT_SIZES"
+    CFLAGS="$CFLAGS -include $MEMSTAT_SIZES"
+fi
+
+# Integer-only code generation (see Source/fpu.h). IRQ and FIQ handlers
+# run on the interrupted task's VFP/NEON registers, so nothing they can
+# reach - kernel, port, memcpy/memset, drivers - may be compiled to use
+# them; at -O2 GCC auto-vectorises byte loops and moves 64-bit values
+# through D registers. A file that really computes in floating point and
+# holds no IRQ/FIQ-reachable code goes in FPU_SOURCES instead.
+FPU_SOURCES=""
+INT_CFLAGS="$CFLAGS -mgeneral-regs-only"
+
+cflags_for() {
+    case " $FPU_SOURCES " in
+        *" $1 "*) echo "$CFLAGS" ;;
+        *)        echo "$INT_CFLAGS" ;;
+    esac
+}
 
 LDFLAGS="-T../$STARTUP_DIR/link_rpi2.ld -nostdlib -lgcc"
 
@@ -55,21 +97,22 @@ echo "Assembling startup code..."
 arm-none-eabi-gcc $ASFLAGS -c -o startup.o ../$STARTUP_DIR/startup_rpi2.S
 
 # Compile main application from Source/
-if [ -f "../$APP_SRC/main.c" ]; then
-    echo "Compiling main application from $APP_SRC/main.c..."
-    arm-none-eabi-gcc $CFLAGS -c -o main.o "../$APP_SRC/main.c"
+if [ -f "../$APP_SRC/$APP_MAIN" ]; then
+    echo "Compiling main application from $APP_SRC/$APP_MAIN..."
+    arm-none-eabi-gcc $(cflags_for $APP_MAIN) -c -o main.o "../$APP_SRC/$APP_MAIN"
 else
-    echo "ERROR: No main.c found in $APP_SRC/"
-    echo "Please create $APP_SRC/main.c with your application code"
+    echo "ERROR: No $APP_MAIN found in $APP_SRC/"
+    echo "Please create $APP_SRC/$APP_MAIN with your application code"
     exit 1
 fi
 
 # Compile any additional source files in Source/ directory
+# (main*.c are alternative image entry points, only APP_MAIN is linked)
 for source in ../$APP_SRC/*.c; do
-    if [ -f "$source" ] && [ "$(basename $source)" != "main.c" ]; then
+    if [ -f "$source" ] && [[ "$(basename $source)" != main*.c ]]; then
         basename=$(basename $source .c)
         echo "  Compiling $basename.c..."
-        arm-none-eabi-gcc $CFLAGS -c -o ${basename}.o "$source"
+        arm-none-eabi-gcc $(cflags_for $basename.c) -c -o ${basename}.o "$source"
         EXTRA_OBJS="$EXTRA_OBJS ${basename}.o"
     fi
 done
@@ -121,7 +164,7 @@ echo "Compiling FreeRTOS core..."
 for source in tasks.c queue.c list.c timers.c event_groups.c stream_buffer.c; do
     if [ -f "../$FREERTOS_KERNEL/$source" ]; then
         echo "  Compiling $source..."
-        arm-none-eabi-gcc $CFLAGS -c -o ${source%.c}.o "../$FREERTOS_KERNEL/$source"
+        arm-none-eabi-gcc $INT_CFLAGS -c -o ${source%.c}.o "../$FREERTOS_KERNEL/$source"
     else
         echo "ERROR: FreeRTOS source $source not found at ../$FREERTOS_KERNEL/$source"
         exit 1
@@ -130,12 +173,12 @@ done
 
 # Compile FreeRTOS port
 echo "Compiling FreeRTOS ARM_CA9 port..."
-arm-none-eabi-gcc $CFLAGS -c -o port.o "../$FREERTOS_PORT/port.c"
+arm-none-eabi-gcc $INT_CFLAGS -c -o port.o "../$FREERTOS_PORT/port.c"
 arm-none-eabi-gcc $ASFLAGS -c -o portASM.o "../$FREERTOS_PORT/portASM.S"
 
 # Compile heap implementation
 echo "Compiling heap_4..."
-arm-none-eabi-gcc $CFLAGS -c -o heap_4.o "../$FREERTOS_HEAP/heap_4.c"
+arm-none-eabi-gcc $INT_CFLAGS -c -o heap_4.o "../$FREERTOS_HEAP/heap_4.c"
 
 # Link everything
 echo "Linking..."
@@ -163,6 +206,21 @@ echo "Build completed successfully!"
 echo ""
 arm-none-eabi-size freertos.elf
 echo ""
+
+# Hot/cold placement report (Source/placement.h) - .text.hot should stay
+# well inside the 32KB Cortex-A53 L1 I-cache (CACHE_L1I_SIZE)
+arm-none-eabi-size -A freertos.elf | awk '
+    $1 ~ /^\.(text|data)\.(hot|cold|isr|percore)$/ { size[$1] = $2 }
+    END {
+        hot = size[".text.hot"] + 0
+        printf "Hot text:  %6d bytes (%d%% of 32KB L1 I-cache)\n", hot, hot * 100 / 32768
+        printf "Cold text: %6d bytes\n", size[".text.cold"]
+        printf "Hot data:  %6d bytes, ISR data %d, per-core data %d\n", \
+               size[".data.hot"], size[".data.isr"], size[".data.percore"]
+        if (hot > 32768)
+            print "WARNING: .text.hot exceeds the L1 I-cache - untag something"
+    }'
+echo ""
 echo "Output file: $BUILD_DIR/kernel7.img"
 echo ""
 echo "To boot on Raspberry Pi 2B v1.2:"
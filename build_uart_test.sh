@@ -8,7 +8,7 @@ cd "$BUILD_DIR"
 rm -f uart_test.elf kernel7.img
 
 CFLAGS="-mcpu=cortex-a53 -mfpu=neon-fp-armv8 -mfloat-abi=hard -marm -nostdlib -ffreestanding -O2 -Wall -I../Source"
-ASFLAGS="-mcpu=cortex-a53 -mfpu=neon-fp-armv8 -mfloat-abi=hard"
+ASFLAGS="-mcpu=cortex-a53 -mfpu=neon-fp-armv8 -mfloat-abi=hard -I../Source"
 LDFLAGS="-T../Startup/link_rpi2.ld -nostdlib -lgcc"
 
 echo "Building minimal UART test..."
@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+"""
+Extract the sizing block of a memstat report from a UART capture.
+
+memstat_report() (Source/memstat.h, or the shell's sizes command) ends
+with a block of #defines between "--- memstat_sizes.h ---" markers. This
+writes the last complete block as a header for the build:
+
+    ./tools/memstat_sizes.py uart.log -o Build/memstat_sizes.h
+    MEMSTAT_SIZES=Build/memstat_sizes.h ./build_rpi2.sh
+
+Take the log from a target soak run - host figures do not apply.
+"""
+
+import argparse
+import re
+import sys
+
+BEGIN = "--- memstat_sizes.h ---"
+END = "--- end memstat_sizes.h ---"
+DEFINE = re.compile(r"^#define (MEMSTAT_(?:HEAP_SIZE|STACK_\w+)) (\d+)$")
+
+
+def parse_uart(lines):
+    """Return (name, value) pairs of the last complete block in a UART log."""
+    sizes = None
+    block = None
+    for line in lines:
+        line = line.strip()
+        if line == BEGIN:
+            block = []
+        elif line == END:
+            if block is not None:
+                sizes = block
+            block = None
+        elif block is not None:
+            m = DEFINE.match(line)
+            if m:
+                block.append((m.group(1), int(m.group(2))))
+    if sizes is None:
+        sys.exit("no complete memstat_sizes.h block found")
+    return sizes
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("input", help="UART log containing a memstat report")
+    parser.add_argument("-o", "--output", help="header to write (default: stdout)")
+    args = parser.parse_args()
+
+    with open(args.input, errors="replace") as f:
+        sizes = parse_uart(f)
+
+    out = ["/* Generated by tools/memstat_sizes.py from %s - see Source/memstat.h */" % args.input,
+           "#ifndef MEMSTAT_SIZES_H",
+           "#define MEMSTAT_SIZES_H",
+           ""]
+    out += ["#define %-40s %u" % (name, value) for name, value in sizes]
+    out += ["", "#endif /* MEMSTAT_SIZES_H */", ""]
+
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write("\n".join(out))
+    else:
+        sys.stdout.write("\n".join(out))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+"""
+Flight recorder decoder for the RPi2 BCM2837 FreeRTOS image.
+
+Reads either a UART capture containing a trace_dump() block
+(TRACE BEGIN ... TRACE END) or, with --raw, a binary memory image of
+trace_buffer (e.g. from a JTAG "dump memory" of the .noinit section),
+and prints a timeline with task names resolved.
+
+    ./tools/trace_decode.py uart.log
+    ./tools/trace_decode.py --raw trace_buffer.bin
+
+Event codes and the record layout must match Source/trace.h.
+"""
+
+import argparse
+import struct
+import sys
+
+CNTPCT_HZ = 19200000
+TRACE_MAGIC = 0x31435254
+HEADER_WORDS = 8
+
+EVENTS = {
+    1: "BOOT",
+    2: "TASK_CREATE",
+    3: "SWITCH_IN",
+    4: "SWITCH_OUT",
+    5: "ISR_ENTER",
+    6: "ISR_EXIT",
+    7: "QUEUE_SEND",
+    8: "QUEUE_SEND_FAILED",
+    9: "QUEUE_RECEIVE",
+    10: "QUEUE_RECV_FAILED",
+    11: "QUEUE_BLOCK_SEND",
+    12: "QUEUE_BLOCK_RECV",
+    13: "QUEUE_SEND_ISR",
+    14: "QUEUE_RECV_ISR",
+    15: "ASSERT",
+    16: "STACK_OVERFLOW",
+    17: "MALLOC_FAILED",
+    18: "FAULT",
+}
+
+QUEUE_TYPES = {
+    0: "queue",
+    1: "mutex",
+    2: "counting-sem",
+    3: "binary-sem",
+    4: "recursive-mutex",
+    5: "queue-set",
+}
+
+FAULTS = {1: "undefined instruction", 2: "prefetch abort", 3: "data abort"}
+
+TRACE_EV_USER = 32
+
+
+def parse_uart(lines):
+    """Return the records of the last complete TRACE block in a UART log."""
+    records = None
+    block = None
+    for line in lines:
+        line = line.strip()
+        if line.startswith("TRACE BEGIN"):
+            block = []
+        elif line.startswith("TRACE END"):
+            if block is not None:
+                records = block
+            block = None
+        elif block is not None and line.startswith("T "):
+            words = [int(w, 16) for w in line.split()[1:5]]
+            stamp, ev_aux, a, b = words
+            block.append((stamp, ev_aux >> 16, ev_aux & 0xFFFF, a, b))
+    if records is None:
+        sys.exit("no complete TRACE BEGIN/END block found")
+    return records
+
+
+def parse_raw(data):
+    """Return the records of a binary trace_buffer image, oldest first."""
+    header = struct.unpack_from("<%dI" % HEADER_WORDS, data, 0)
+    magic, ring_size, boot_count, fault_pending, head = header[:5]
+    if magic != TRACE_MAGIC:
+        sys.exit("bad magic 0x%08x - not a trace_buffer image" % magic)
+    print("boot %u, %u records written, fault pending: %s"
+          % (boot_count, head, "yes" if fault_pending else "no"))
+
+    count = min(head, ring_size)
+    records = []
+    for i in range(head - count, head):
+        offset = HEADER_WORDS * 4 + (i % ring_size) * 16
+        stamp, event, aux, a, b = struct.unpack_from("<IHHII", data, offset)
+        records.append((stamp, event, aux, a, b))
+    return records
+
+
+def unpack_name(a, b):
+    raw = struct.pack("<II", a, b)
+    return raw.split(b"\0", 1)[0].decode("ascii", "replace")
+
+
+def describe(event, aux, a, b, names):
+    task = names.get(aux, "#%u" % aux)
+    if event == 1:
+        return "boot count %u" % a
+    if event == 2:
+        names[aux] = unpack_name(a, b)
+        return "task #%u '%s'" % (aux, names[aux])
+    if event in (3, 4):
+        return "%s (tcb 0x%08x)" % (task, a)
+    if event == 5:
+        return "pending 0x%08x" % a
+    if 7 <= event <= 14:
+        return "%s 0x%08x, %u items" % (QUEUE_TYPES.get(aux, "type %u" % aux), a, b)
+    if event == 15:
+        return "line %u, file at 0x%08x" % (a, b)
+    if event == 16:
+        if b:
+            return "task handle 0x%08x, guard page hit at sp 0x%08x" % (a, b)
+        return "task handle 0x%08x" % a
+    if event == 18:
+        return "%s at pc 0x%08x, address 0x%08x" % (FAULTS.get(aux, "?"), a, b)
+    return "aux %u a 0x%08x b 0x%08x" % (aux, a, b)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("input", help="UART log, or trace_buffer image with --raw")
+    parser.add_argument("--raw", action="store_true", help="input is a binary trace_buffer image")
+    args = parser.parse_args()
+
+    if args.raw:
+        with open(args.input, "rb") as f:
+            records = parse_raw(f.read())
+    else:
+        with open(args.input, errors="replace") as f:
+            records = parse_uart(f)
+
+    names = {}
+    elapsed = 0
+    prev = records[0][0] if records else 0
+    for stamp, event, aux, a, b in records:
+        elapsed += (stamp - prev) & 0xFFFFFFFF     # CNTPCT low word wraps every 223 s
+        prev = stamp
+        if event >= TRACE_EV_USER:
+            name = "USER+%u" % (event - TRACE_EV_USER)
+        else:
+            name = EVENTS.get(event, "EVENT_%u" % event)
+        print("%14.3f us  %-18s %s" % (elapsed * 1e6 / CNTPCT_HZ, name,
+                                       describe(event, aux, a, b, names)))
+
+
+if __name__ == "__main__":
+    main()